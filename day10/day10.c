@@ -6,25 +6,37 @@
 */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <threads.h>
+
+#define THREAD_COUNT 8
 
 struct vec {int X, Y;};
 
+int
+Gcd(int A, int B)
+{
+    A = A > 0 ? A : -A;
+    B = B > 0 ? B : -B;
+    while(B)
+    {
+        int Rest = A % B;
+        A = B;
+        B = Rest;
+    }
+    return A;
+}
+
 struct vec
 SimplifyFraction(struct vec F)
 {
-    int AbsoluteX = F.X > 0 ? F.X : -F.X;
-    int AbsoluteY = F.Y > 0 ? F.Y : -F.Y;
-    for(int Denominator = (AbsoluteX > AbsoluteY) ? AbsoluteX : AbsoluteY;
-        Denominator > 0;
-        --Denominator)
+    int Denominator = Gcd(F.X, F.Y);
+    if(Denominator > 1)
     {
-        if(F.X % Denominator == 0 && F.Y % Denominator == 0)
-        {
-            F.X /= Denominator;
-            F.Y /= Denominator;
-        }
+        F.X /= Denominator;
+        F.Y /= Denominator;
     }
     return F;
 }
@@ -41,36 +53,106 @@ FindAngle(struct vec A, struct vec B)
     return Result;
 }
 
+// Directions seen from one station. Slots are stamped with the station they
+// were filled for, so moving to the next station doesn't clear the table.
+struct angle_set
+{
+    uint64_t* Keys;
+    uint32_t* Stamps;
+    uint32_t Mask; // Capacity - 1, the capacity is a power of two
+    uint32_t Stamp;
+};
+
+struct angle_set
+MakeAngleSet(int StarCount)
+{
+    uint32_t Capacity = 16;
+    while(Capacity < 2 * (uint32_t)StarCount)
+    {
+        Capacity *= 2;
+    }
+    struct angle_set Set =
+    {
+        .Keys = malloc(sizeof(uint64_t) * Capacity),
+        .Stamps = calloc(Capacity, sizeof(uint32_t)),
+        .Mask = Capacity - 1,
+    };
+    return Set;
+}
+
+// Returns true if the angle wasn't in the set yet
+bool
+AddAngle(struct angle_set* Set, struct vec Angle)
+{
+    uint64_t Key = (uint64_t)(uint32_t)Angle.X << 32 | (uint32_t)Angle.Y;
+    uint64_t Hash = Key * 0x9e3779b97f4a7c15ull;
+    for(uint32_t Slot = (uint32_t)(Hash >> 32) & Set->Mask;
+        ;
+        Slot = (Slot + 1) & Set->Mask)
+    {
+        if(Set->Stamps[Slot] != Set->Stamp)
+        {
+            Set->Stamps[Slot] = Set->Stamp;
+            Set->Keys[Slot] = Key;
+            return true;
+        }
+        if(Set->Keys[Slot] == Key)
+        {
+            return false;
+        }
+    }
+}
+
 int
-CountNeighbours(struct vec Star, int StarCount, struct vec Stars[])
+CountNeighbours(struct vec Star, int StarCount, struct vec Stars[], struct angle_set* Set)
 {
-    struct vec Angles[1024] = {0};
+    ++Set->Stamp;
     int Count = 0;
     for(int StarIdx = 0; StarIdx < StarCount; ++StarIdx)
     {
-        struct vec Angle = FindAngle(Star, Stars[StarIdx]);
-        bool Occluded = false;
-        for(int Index = 0; Index < Count; ++Index)
+        if(Stars[StarIdx].X == Star.X && Stars[StarIdx].Y == Star.Y)
         {
-            if(Angles[Index].X == Angle.X && Angles[Index].Y == Angle.Y)
-            {
-                Occluded = true;
-                break;
-            }
+            continue; // not a naighbour to itself
         }
-        if(!Occluded)
+        if(AddAngle(Set, FindAngle(Star, Stars[StarIdx])))
         {
-            Angles[Count++] = Angle;
+            ++Count;
         }
     }
-    --Count; // not a naighbour to itself
     return Count;
 }
 
+// Every THREAD_COUNT-th station goes to the same worker, so the work is even
+// however the field is laid out
+struct survey
+{
+    struct vec* Stars;
+    int StarCount;
+    int First;
+    int* Counts;
+};
+
+int
+SurveyStations(void* Data)
+{
+    struct survey* Survey = Data;
+    struct angle_set Set = MakeAngleSet(Survey->StarCount);
+    for(int StarIdx = Survey->First;
+        StarIdx < Survey->StarCount;
+        StarIdx += THREAD_COUNT)
+    {
+        Survey->Counts[StarIdx] = CountNeighbours(Survey->Stars[StarIdx], Survey->StarCount, Survey->Stars, &Set);
+    }
+    free(Set.Keys);
+    free(Set.Stamps);
+    return 0;
+}
+
 int
 main(void)
 {
-    struct vec Stars[1024] = {0};
+    int StarCapacity = 1024;
+    struct vec* Stars = malloc(sizeof(struct vec) * StarCapacity);
     int StarCount = 0;
 
     FILE* Input = fopen("day10_input.txt", "rb");
@@ -78,7 +160,7 @@ main(void)
     int Height = 0;
     for(;;)
     {
-        char Char = fgetc(Input);
+        int Char = fgetc(Input);
         if(Char == EOF)
         {
             break;
@@ -91,17 +173,44 @@ main(void)
         }
         if(Char == '#')
         {
+            if(StarCount == StarCapacity)
+            {
+                StarCapacity *= 2;
+                Stars = realloc(Stars, sizeof(struct vec) * StarCapacity);
+            }
             Stars[StarCount++] = (struct vec) {Width, Height};
         }
         ++Width;
     }
     ++Height;
+    fclose(Input);
+
+    int* Counts = malloc(sizeof(int) * StarCount);
+    struct survey Surveys[THREAD_COUNT];
+    thrd_t Threads[THREAD_COUNT];
+    for(int Index = 0;
+        Index < THREAD_COUNT;
+        ++Index)
+    {
+        Surveys[Index] = (struct survey){Stars, StarCount, Index, Counts};
+        if(thrd_create(&Threads[Index], SurveyStations, &Surveys[Index]) != thrd_success)
+        {
+            printf("Failed to start a worker\n");
+            return 1;
+        }
+    }
+    for(int Index = 0;
+        Index < THREAD_COUNT;
+        ++Index)
+    {
+        thrd_join(Threads[Index], NULL);
+    }
 
-    int BestX, BestY;
+    int BestX = 0, BestY = 0;
     int BestCount = 0;
     for(int StarIdx = 0; StarIdx < StarCount; ++StarIdx)
     {
-        int Count = CountNeighbours(Stars[StarIdx], StarCount, Stars);
+        int Count = Counts[StarIdx];
         if(Count > BestCount)
         {
             BestX = Stars[StarIdx].X;
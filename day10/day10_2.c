@@ -11,6 +11,8 @@
 #include <limits.h>
 #include <math.h>
 
+#define EXACT 1 // Order every vaporization up front with integer angles
+
 // FUCK
 // FUCK
 // FUCK
@@ -131,6 +133,108 @@ GetNextLaserAngle(struct vec LaserPosition, struct vec LaserAngle, int StarCount
     return Result;
 }
 
+// Which half of the clockwise turn from straight up V points into. The Y
+// axis points down, so up is the first half along with everything to its
+// right.
+static inline int
+AngleHalf(struct vec V)
+{
+    return (V.X > 0 || (V.X == 0 && V.Y < 0)) ? 0 : 1;
+}
+
+// Whether A points before B going clockwise from straight up
+int
+CompareAngles(struct vec A, struct vec B)
+{
+    int HalfA = AngleHalf(A);
+    int HalfB = AngleHalf(B);
+    if(HalfA != HalfB)
+    {
+        return HalfA - HalfB;
+    }
+    long long Cross = (long long)A.X * B.Y - (long long)A.Y * B.X;
+    return (Cross > 0) ? -1 : (Cross < 0) ? 1 : 0;
+}
+
+struct laser_target
+{
+    struct vec Offset; // From the laser, not simplified
+    int Round; // Turns of the laser before it gets to this one
+    int Star;
+};
+
+int
+CompareTargets(const void* A, const void* B)
+{
+    const struct laser_target* TargetA = A;
+    const struct laser_target* TargetB = B;
+    int Result = CompareAngles(TargetA->Offset, TargetB->Offset);
+    if(Result == 0)
+    {
+        // Same ray, so comparing one coordinate is comparing distance
+        int DistanceA = abs(TargetA->Offset.X) + abs(TargetA->Offset.Y);
+        int DistanceB = abs(TargetB->Offset.X) + abs(TargetB->Offset.Y);
+        Result = (DistanceA > DistanceB) - (DistanceA < DistanceB);
+    }
+    return Result;
+}
+
+// Fills Order with star indices in the order the laser vaporizes them and
+// returns how many there are. Sorting by angle then distance puts every ray
+// in a run, a star's place in its run is the turn it goes on, and a stable
+// counting sort on the turn deals the rays out round-robin.
+int
+OrderVaporization(struct vec LaserPosition, int StarCount, struct vec Stars[], int Order[])
+{
+    struct laser_target* Targets = malloc(sizeof(struct laser_target) * StarCount);
+    int TargetCount = 0;
+    for(int Index = 0; Index < StarCount; ++Index)
+    {
+        struct vec Offset =
+        {
+            .X = Stars[Index].X - LaserPosition.X,
+            .Y = Stars[Index].Y - LaserPosition.Y
+        };
+        if(Offset.X != 0 || Offset.Y != 0)
+        {
+            Targets[TargetCount++] = (struct laser_target){Offset, 0, Index};
+        }
+    }
+
+    qsort(Targets, TargetCount, sizeof(struct laser_target), CompareTargets);
+
+    int RoundCount = 0;
+    for(int Index = 0; Index < TargetCount; ++Index)
+    {
+        if(Index > 0 && CompareAngles(Targets[Index-1].Offset, Targets[Index].Offset) == 0)
+        {
+            Targets[Index].Round = Targets[Index-1].Round + 1;
+        }
+        if(Targets[Index].Round >= RoundCount)
+        {
+            RoundCount = Targets[Index].Round + 1;
+        }
+    }
+
+    int* RoundStart = calloc(RoundCount + 1, sizeof(int));
+    for(int Index = 0; Index < TargetCount; ++Index)
+    {
+        ++RoundStart[Targets[Index].Round + 1];
+    }
+    for(int Round = 0; Round < RoundCount; ++Round)
+    {
+        RoundStart[Round + 1] += RoundStart[Round];
+    }
+    for(int Index = 0; Index < TargetCount; ++Index)
+    {
+        Order[RoundStart[Targets[Index].Round]++] = Targets[Index].Star;
+    }
+
+    free(RoundStart);
+    free(Targets);
+    return TargetCount;
+}
+
 int
 main(void)
 {
@@ -144,7 +248,7 @@ main(void)
     int Height = 0;
     for(;;)
     {
-        char Char = fgetc(Input);
+        int Char = fgetc(Input);
         if(Char == EOF)
         {
             break;
@@ -162,10 +266,22 @@ main(void)
         ++Width;
     }
     ++Height;
+    fclose(Input);
+
+    struct vec LaserPosition = {26,29};
 
+#if EXACT
+    int* Order = malloc(sizeof(int) * StarCount);
+    int VaporizedCount = OrderVaporization(LaserPosition, StarCount, Stars, Order);
+    if(VaporizedCount < 200)
+    {
+        printf("Only %d asteroids to vaporize\n", VaporizedCount);
+        return 1;
+    }
+    struct vec VaporizedStar = Stars[Order[200-1]];
+#else
     int Map[512][512] = {0};
 
-    struct vec LaserPosition = {26,29};
     struct vec LaserAngle = {0,-1};
     struct vec VaporizedStar;
     int VaporizedCount = 0;
@@ -206,6 +322,7 @@ main(void)
         }
         printf("\n");
     }
+#endif
 
     printf("Result: X=%d, Y=%d\n", VaporizedStar.X, VaporizedStar.Y);
 }
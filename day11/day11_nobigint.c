@@ -6,6 +6,7 @@
 */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -159,13 +160,6 @@ enum mod
     MOD_MOV
 };
 
-struct panel
-{
-    struct pos Pos;
-    enum col Col;
-    int PaintCount;
-};
-
 enum dir
 Rotate(enum dir Direction, bool Right)
 {
@@ -188,20 +182,137 @@ Advance(struct pos Position, enum dir Direction)
     return New;
 }
 
-int
-GetPanel(int Count, struct panel Panels[], struct pos Position)
+// Panels live in square chunks found through a hash table keyed on the chunk
+// coordinates, the hull grows in any direction and lookups stay O(1)
+#define CHUNK_SHIFT 4
+#define CHUNK_SIZE (1 << CHUNK_SHIFT)
+#define CHUNK_PANELS (CHUNK_SIZE * CHUNK_SIZE)
+#define CHUNK_WORDS (CHUNK_PANELS / 64)
+
+struct chunk
+{
+    struct pos Pos; // In chunks, not panels
+    uint64_t Colors[CHUNK_WORDS]; // One bit per panel, set for white
+    uint64_t Known[CHUNK_WORDS];  // Panels that were painted or given a color
+    int PaintCount[CHUNK_PANELS];
+};
+
+struct hull
 {
-    for(int Index = 0;
-        Index < Count;
-        ++Index)
+    struct chunk** Chunks; // Open addressing, the capacity is a power of two
+    int Capacity;
+    int ChunkCount;
+    int PanelCount;
+};
+
+uint32_t
+HashChunk(struct pos Pos)
+{
+    uint32_t Hash = (uint32_t)Pos.X * 0x9e3779b1u ^ (uint32_t)Pos.Y * 0x85ebca77u;
+    return Hash ^ (Hash >> 15);
+}
+
+struct chunk**
+FindChunk(struct hull* Hull, struct pos Pos)
+{
+    uint32_t Mask = Hull->Capacity - 1;
+    for(uint32_t Slot = HashChunk(Pos) & Mask;
+        ;
+        Slot = (Slot + 1) & Mask)
     {
-        if( Panels[Index].Pos.X == Position.X &&
-            Panels[Index].Pos.Y == Position.Y)
+        struct chunk** Chunk = &Hull->Chunks[Slot];
+        if(!*Chunk || ((*Chunk)->Pos.X == Pos.X && (*Chunk)->Pos.Y == Pos.Y))
         {
-            return Index;
+            return Chunk;
         }
     }
-    return -1;
+}
+
+// Keep the table at most half full
+void
+GrowHull(struct hull* Hull)
+{
+    struct chunk** Old = Hull->Chunks;
+    int OldCapacity = Hull->Capacity;
+
+    Hull->Capacity = OldCapacity ? OldCapacity * 2 : 64;
+    Hull->Chunks = calloc(Hull->Capacity, sizeof(struct chunk*));
+    for(int Index = 0; Index < OldCapacity; ++Index)
+    {
+        if(Old[Index])
+        {
+            *FindChunk(Hull, Old[Index]->Pos) = Old[Index];
+        }
+    }
+    free(Old);
+}
+
+// Returns the chunk holding a panel and the panel's index in it, chunks are
+// only created when Create is set, otherwise missing ones come back null
+struct chunk*
+GetChunk(struct hull* Hull, struct pos Position, bool Create, int* Index)
+{
+    // Arithmetic shifts round down so negative panels land in the right chunk
+    struct pos Pos = {Position.X >> CHUNK_SHIFT, Position.Y >> CHUNK_SHIFT};
+    *Index = (Position.Y & (CHUNK_SIZE - 1)) * CHUNK_SIZE + (Position.X & (CHUNK_SIZE - 1));
+
+    if(Hull->Capacity == 0)
+    {
+        if(!Create)
+        {
+            return 0;
+        }
+        GrowHull(Hull);
+    }
+
+    struct chunk** Chunk = FindChunk(Hull, Pos);
+    if(!*Chunk && Create)
+    {
+        if(2 * (Hull->ChunkCount + 1) > Hull->Capacity)
+        {
+            GrowHull(Hull);
+            Chunk = FindChunk(Hull, Pos);
+        }
+        *Chunk = calloc(1, sizeof(struct chunk));
+        (*Chunk)->Pos = Pos;
+        ++Hull->ChunkCount;
+    }
+    return *Chunk;
+}
+
+enum col
+GetColor(struct hull* Hull, struct pos Position)
+{
+    int Index;
+    struct chunk* Chunk = GetChunk(Hull, Position, false, &Index);
+    if(!Chunk)
+    {
+        return COL_BLACK;
+    }
+    return (Chunk->Colors[Index / 64] >> (Index % 64)) & 1;
+}
+
+void
+Paint(struct hull* Hull, struct pos Position, enum col Col, int PaintCount)
+{
+    int Index;
+    struct chunk* Chunk = GetChunk(Hull, Position, true, &Index);
+
+    uint64_t Bit = 1ull << (Index % 64);
+    if(!(Chunk->Known[Index / 64] & Bit))
+    {
+        Chunk->Known[Index / 64] |= Bit;
+        ++Hull->PanelCount;
+    }
+    if(Col == COL_WHITE)
+    {
+        Chunk->Colors[Index / 64] |= Bit;
+    }
+    else
+    {
+        Chunk->Colors[Index / 64] &= ~Bit;
+    }
+    Chunk->PaintCount[Index] += PaintCount;
 }
 
 int
@@ -225,17 +336,8 @@ main(void)
     puts("Program loaded");
 
     // Hull
-    struct panel* Panels = malloc(sizeof(struct panel) * 16 * 1024);
-    memset(Panels, 0, sizeof(int) * 16 * 1024);
-
-    int PanelCount = 0;
-
-    Panels[PanelCount++] = (struct panel)
-    {
-        .Pos = {0,0},
-        .Col = COL_WHITE,
-        .PaintCount = 0
-    };
+    struct hull Hull = {0};
+    Paint(&Hull, (struct pos){0,0}, COL_WHITE, 0);
 
     // Robot
     enum col Col = COL_BLACK;
@@ -278,8 +380,7 @@ main(void)
             }
             case OP_IN:
             {
-                int Index = GetPanel(PanelCount, Panels, Pos);
-                Store(Index == -1 ? COL_BLACK : Panels[Index].Col);
+                Store(GetColor(&Hull, Pos));
                 break;
             }
             case OP_OUT:
@@ -293,21 +394,7 @@ main(void)
                 else // MOD_MOV
                 {
                     // Paint
-                    int Index = GetPanel(PanelCount, Panels, Pos);
-                    if(Index == -1)
-                    {
-                        Panels[PanelCount++] = (struct panel)
-                        {
-                            .Pos = Pos,
-                            .Col = Col,
-                            .PaintCount = 1
-                        };
-                    }
-                    else
-                    {
-                        Panels[Index].Col = Col;
-                        Panels[Index].PaintCount += 1;
-                    }
+                    Paint(&Hull, Pos, Col, 1);
                     //printf("%-8s %2d %2d\n", "Paint:", Pos.X, Pos.Y);
 
                     // Advance
@@ -369,8 +456,7 @@ main(void)
                         }
                         else
                         {
-                            int Index = GetPanel(PanelCount, Panels, (struct pos){X,Y});
-                            if(Index == -1 || Panels[Index].Col == COL_BLACK)
+                            if(GetColor(&Hull, (struct pos){X,Y}) == COL_BLACK)
                             {
                                 printf(".");
                             }
@@ -382,7 +468,7 @@ main(void)
                     }
                     printf("\n");
                 }
-                printf("Painted %d panels\n", PanelCount);
+                printf("Painted %d panels\n", Hull.PanelCount);
                 return 0;
             }
             default:
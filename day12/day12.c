@@ -8,6 +8,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 struct moon
 {
     int Pos[3];
@@ -17,6 +21,116 @@ struct moon
     int Tot;
 };
 
+#ifdef __AVX2__
+#define LANE_REGISTERS 2 // Up to 16 bodies stay in registers
+
+// Speed changes for up to 16 bodies on one axis, one body per lane in one or
+// two registers. Each rotation of a register lines every body up against
+// another one: 7 rotations of a body's own register and 8 of the other one
+// cover every pair. Lanes past the last body are masked out both ways.
+void
+GravityLanes(const __m256i Pos[], const __m256i Valid[], int Registers, __m256i Delta[])
+{
+    __m256i Lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for(int Register = 0; Register < Registers; ++Register)
+    {
+        __m256i Sum = _mm256_setzero_si256();
+        for(int From = 0; From < Registers; ++From)
+        {
+            for(int Shift = From == Register; Shift < 8; ++Shift)
+            {
+                __m256i Rotate = _mm256_and_si256(_mm256_add_epi32(Lane, _mm256_set1_epi32(Shift)), _mm256_set1_epi32(7));
+                __m256i Other = _mm256_permutevar8x32_epi32(Pos[From], Rotate);
+                __m256i OtherValid = _mm256_permutevar8x32_epi32(Valid[From], Rotate);
+
+                // Comparisons are -1 where true
+                __m256i Above = _mm256_and_si256(_mm256_cmpgt_epi32(Other, Pos[Register]), OtherValid);
+                __m256i Below = _mm256_and_si256(_mm256_cmpgt_epi32(Pos[Register], Other), OtherValid);
+                Sum = _mm256_add_epi32(Sum, _mm256_sub_epi32(Below, Above));
+            }
+        }
+        Delta[Register] = _mm256_and_si256(Sum, Valid[Register]);
+    }
+}
+
+// Count can run out before the register does, or before it starts
+__m256i
+ValidLanes(int Count)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(Count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+#endif
+
+#ifdef __AVX2__
+// Run up to 16 moons with each axis in one or two registers
+void
+SimulateLanes(struct moon Moons[], int Count, int Ticks)
+{
+    int Registers = (Count + 7) / 8;
+    __m256i Valid[LANE_REGISTERS];
+    __m256i Pos[3][LANE_REGISTERS], Vel[3][LANE_REGISTERS];
+    for(int Register = 0; Register < Registers; ++Register)
+    {
+        Valid[Register] = ValidLanes(Count - 8 * Register);
+    }
+    for(int Axis = 0; Axis < 3; ++Axis)
+    {
+        int Lanes[8 * LANE_REGISTERS] = {0};
+        for(int Index = 0; Index < Count; ++Index)
+        {
+            Lanes[Index] = Moons[Index].Pos[Axis];
+        }
+        for(int Register = 0; Register < Registers; ++Register)
+        {
+            Pos[Axis][Register] = _mm256_loadu_si256((__m256i*)&Lanes[8 * Register]);
+        }
+        for(int Index = 0; Index < Count; ++Index)
+        {
+            Lanes[Index] = Moons[Index].Vel[Axis];
+        }
+        for(int Register = 0; Register < Registers; ++Register)
+        {
+            Vel[Axis][Register] = _mm256_loadu_si256((__m256i*)&Lanes[8 * Register]);
+        }
+    }
+
+    for(int Tick = 0; Tick < Ticks; ++Tick)
+    {
+        for(int Axis = 0; Axis < 3; ++Axis)
+        {
+            __m256i Delta[LANE_REGISTERS];
+            GravityLanes(Pos[Axis], Valid, Registers, Delta);
+            for(int Register = 0; Register < Registers; ++Register)
+            {
+                Vel[Axis][Register] = _mm256_add_epi32(Vel[Axis][Register], Delta[Register]);
+                Pos[Axis][Register] = _mm256_add_epi32(Pos[Axis][Register], Vel[Axis][Register]);
+            }
+        }
+    }
+
+    for(int Axis = 0; Axis < 3; ++Axis)
+    {
+        int Lanes[8 * LANE_REGISTERS];
+        for(int Register = 0; Register < Registers; ++Register)
+        {
+            _mm256_storeu_si256((__m256i*)&Lanes[8 * Register], Pos[Axis][Register]);
+        }
+        for(int Index = 0; Index < Count; ++Index)
+        {
+            Moons[Index].Pos[Axis] = Lanes[Index];
+        }
+        for(int Register = 0; Register < Registers; ++Register)
+        {
+            _mm256_storeu_si256((__m256i*)&Lanes[8 * Register], Vel[Axis][Register]);
+        }
+        for(int Index = 0; Index < Count; ++Index)
+        {
+            Moons[Index].Vel[Axis] = Lanes[Index];
+        }
+    }
+}
+#endif
+
 int
 main(void)
 {
@@ -29,7 +143,18 @@ main(void)
         ++Count;
     }
 
-    for(int Tick = 0; Tick < 1000; ++Tick)
+    int Ticks = 1000;
+#ifdef __AVX2__
+    if(Count <= 8 * LANE_REGISTERS)
+    {
+        SimulateLanes(Moons, Count, Ticks);
+        Ticks = 0;
+    }
+#endif
+
+    // More than 16 bodies take the scalar loop
+
+    for(int Tick = 0; Tick < Ticks; ++Tick)
     {
         // // Print
         // printf("Tick %d\n", Tick);
@@ -66,19 +191,19 @@ main(void)
                 Moons[Index].Pos[Axis] += Moons[Index].Vel[Axis];
             }
         }
+    }
 
-        // Total energy
-        for(int Index = 0; Index < Count; ++Index)
+    // Total energy
+    for(int Index = 0; Index < Count; ++Index)
+    {
+        Moons[Index].Pot = 0;
+        Moons[Index].Kin = 0;
+        for(int Axis = 0; Axis < 3; ++Axis)
         {
-            Moons[Index].Pot = 0;
-            Moons[Index].Kin = 0;
-            for(int Axis = 0; Axis < 3; ++Axis)
-            {
-                Moons[Index].Pot += abs(Moons[Index].Pos[Axis]);
-                Moons[Index].Kin += abs(Moons[Index].Vel[Axis]);
-            }
-            Moons[Index].Tot = Moons[Index].Pot * Moons[Index].Kin;
+            Moons[Index].Pot += abs(Moons[Index].Pos[Axis]);
+            Moons[Index].Kin += abs(Moons[Index].Vel[Axis]);
         }
+        Moons[Index].Tot = Moons[Index].Pot * Moons[Index].Kin;
     }
 
     int TotalEnergy = 0;
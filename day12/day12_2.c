@@ -9,24 +9,210 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
-struct moon
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// The axes never interact, so each one is its own system with its own
+// period. Bodies are stored one array per axis.
+struct axis
 {
-    int Pos[3];
-    int Vel[3];
+    int* Pos;
+    int* Vel;
+    int* Initial;
+    unsigned long long* Keys; // Position and body packed together, sorted each tick
+    int Count;
+    long long Period;
 };
 
+int
+CompareKeys(const void* A, const void* B)
+{
+    unsigned long long KeyA = *(const unsigned long long*)A;
+    unsigned long long KeyB = *(const unsigned long long*)B;
+    return (KeyA > KeyB) - (KeyA < KeyB);
+}
+
+// Every body pulls every other one a step towards it, so a body speeds up by
+// the number of bodies above it minus the number below it. With the bodies
+// sorted by position both are ranks, which makes a tick O(n log n).
 void
-Print(int Count, struct moon Moons[])
+Gravity(struct axis* Axis)
 {
-    for(int Index = 0; Index < Count; ++Index)
+    // Flipping the sign bit biases positions so unsigned order is signed
+    // order, and shifting an unsigned value is defined for all of them
+    for(int Index = 0; Index < Axis->Count; ++Index)
     {
-        printf("%d) Pos=(%3d,%3d,%3d) Vel=(%3d,%3d,%3d)\n", Index,
-            Moons[Index].Pos[0], Moons[Index].Pos[1], Moons[Index].Pos[2],
-            Moons[Index].Vel[0], Moons[Index].Vel[1], Moons[Index].Vel[2]);
+        unsigned int Biased = (unsigned int)Axis->Pos[Index] ^ 0x80000000u;
+        Axis->Keys[Index] = (unsigned long long)Biased << 32 | (unsigned int)Index;
+    }
+    qsort(Axis->Keys, Axis->Count, sizeof(unsigned long long), CompareKeys);
+
+    for(int First = 0; First < Axis->Count;)
+    {
+        // Bodies at the same position don't pull each other
+        unsigned long long Pos = Axis->Keys[First] >> 32;
+        int Last = First;
+        while(Last + 1 < Axis->Count && (Axis->Keys[Last + 1] >> 32) == Pos)
+        {
+            ++Last;
+        }
+
+        int Below = First;
+        int Above = Axis->Count - Last - 1;
+        for(int Rank = First; Rank <= Last; ++Rank)
+        {
+            Axis->Vel[Axis->Keys[Rank] & 0xffffffff] += Above - Below;
+        }
+        First = Last + 1;
     }
 }
 
+void
+Velocity(struct axis* Axis)
+{
+    for(int Index = 0; Index < Axis->Count; ++Index)
+    {
+        Axis->Pos[Index] += Axis->Vel[Index];
+    }
+}
+
+// Back where it started with everything at rest
+bool
+AtInitialState(struct axis* Axis)
+{
+    for(int Index = 0; Index < Axis->Count; ++Index)
+    {
+        if(Axis->Pos[Index] != Axis->Initial[Index] || Axis->Vel[Index] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef __AVX2__
+#define LANE_REGISTERS 2 // Up to 16 bodies stay in registers
+
+// Speed changes for up to 16 bodies on one axis, one body per lane in one or
+// two registers. Each rotation of a register lines every body up against
+// another one: 7 rotations of a body's own register and 8 of the other one
+// cover every pair. Lanes past the last body are masked out both ways.
+void
+GravityLanes(const __m256i Pos[], const __m256i Valid[], int Registers, __m256i Delta[])
+{
+    __m256i Lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for(int Register = 0; Register < Registers; ++Register)
+    {
+        __m256i Sum = _mm256_setzero_si256();
+        for(int From = 0; From < Registers; ++From)
+        {
+            for(int Shift = From == Register; Shift < 8; ++Shift)
+            {
+                __m256i Rotate = _mm256_and_si256(_mm256_add_epi32(Lane, _mm256_set1_epi32(Shift)), _mm256_set1_epi32(7));
+                __m256i Other = _mm256_permutevar8x32_epi32(Pos[From], Rotate);
+                __m256i OtherValid = _mm256_permutevar8x32_epi32(Valid[From], Rotate);
+
+                // Comparisons are -1 where true
+                __m256i Above = _mm256_and_si256(_mm256_cmpgt_epi32(Other, Pos[Register]), OtherValid);
+                __m256i Below = _mm256_and_si256(_mm256_cmpgt_epi32(Pos[Register], Other), OtherValid);
+                Sum = _mm256_add_epi32(Sum, _mm256_sub_epi32(Below, Above));
+            }
+        }
+        Delta[Register] = _mm256_and_si256(Sum, Valid[Register]);
+    }
+}
+
+// Count can run out before the register does, or before it starts
+__m256i
+ValidLanes(int Count)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(Count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+#endif
+
+#ifdef __AVX2__
+// Up to 16 bodies fit in two registers, so the whole tick and the check
+// against the initial state stay in registers
+long long
+FindPeriodLanes(struct axis* Axis)
+{
+    int Registers = (Axis->Count + 7) / 8;
+    int Lanes[8 * LANE_REGISTERS] = {0};
+    memcpy(Lanes, Axis->Initial, sizeof(int) * Axis->Count);
+
+    __m256i Zero = _mm256_setzero_si256();
+    __m256i Valid[LANE_REGISTERS], Initial[LANE_REGISTERS];
+    __m256i Pos[LANE_REGISTERS], Vel[LANE_REGISTERS];
+    for(int Register = 0; Register < Registers; ++Register)
+    {
+        Valid[Register] = ValidLanes(Axis->Count - 8 * Register);
+        Initial[Register] = _mm256_loadu_si256((__m256i*)&Lanes[8 * Register]);
+        Pos[Register] = Initial[Register];
+        Vel[Register] = Zero;
+    }
+
+    long long Tick = 0;
+    __m256i Same;
+    do
+    {
+        __m256i Delta[LANE_REGISTERS];
+        GravityLanes(Pos, Valid, Registers, Delta);
+        Same = _mm256_set1_epi32(-1);
+        for(int Register = 0; Register < Registers; ++Register)
+        {
+            Vel[Register] = _mm256_add_epi32(Vel[Register], Delta[Register]);
+            Pos[Register] = _mm256_add_epi32(Pos[Register], Vel[Register]);
+            Same = _mm256_and_si256(Same, _mm256_and_si256(_mm256_cmpeq_epi32(Pos[Register], Initial[Register]), _mm256_cmpeq_epi32(Vel[Register], Zero)));
+        }
+        ++Tick;
+    }
+    while(_mm256_movemask_epi8(Same) != -1);
+
+    for(int Register = 0; Register < Registers; ++Register)
+    {
+        _mm256_storeu_si256((__m256i*)&Lanes[8 * Register], Pos[Register]);
+    }
+    memcpy(Axis->Pos, Lanes, sizeof(int) * Axis->Count);
+    for(int Register = 0; Register < Registers; ++Register)
+    {
+        _mm256_storeu_si256((__m256i*)&Lanes[8 * Register], Vel[Register]);
+    }
+    memcpy(Axis->Vel, Lanes, sizeof(int) * Axis->Count);
+    return Tick;
+}
+#endif
+
+int
+FindPeriod(void* Data)
+{
+    struct axis* Axis = Data;
+
+#ifdef __AVX2__
+    if(Axis->Count <= 8 * LANE_REGISTERS)
+    {
+        Axis->Period = FindPeriodLanes(Axis);
+        return 0;
+    }
+#endif
+
+    // More than 16 bodies take the scalar loop
+
+    long long Tick = 0;
+    do
+    {
+        Gravity(Axis);
+        Velocity(Axis);
+        ++Tick;
+    }
+    while(!AtInitialState(Axis));
+
+    Axis->Period = Tick;
+    return 0;
+}
+
 long long
 GCD(long long A, long long B)
 {
@@ -85,81 +271,52 @@ LCM(long long A, long long B)
 int
 main(void)
 {
-    struct moon Moons[128] = {0};
+    struct axis Axes[3] = {0};
+    int Capacity = 0;
     int Count = 0;
 
     FILE* Input = fopen("day12_input.txt", "r");
-    while(fscanf(Input, "<x=%d, y=%d, z=%d>\n", &Moons[Count].Pos[0], &Moons[Count].Pos[1], &Moons[Count].Pos[2]) != EOF)
-    {
-        ++Count;
-    }
-
-    struct moon InitialState[128] = {0};
-    memcpy(&InitialState, &Moons, sizeof(struct moon) * Count);
-
-    long long OrbitTimes[3] = {-1,-1,-1};
-
-    long long Tick = 0;
-    while(OrbitTimes[0] == -1 || OrbitTimes[1] == -1 || OrbitTimes[2] == -1)
+    int X, Y, Z;
+    while(fscanf(Input, "<x=%d, y=%d, z=%d>\n", &X, &Y, &Z) == 3)
     {
-        //printf("Tick %lld\n", Tick);
-
-        // Compare with initial positions
-        if(Tick != 0)
+        if(Count == Capacity)
         {
-            // TODO: This way of doing things sucks for cache
+            Capacity = Capacity ? Capacity * 2 : 64;
             for(int Axis = 0; Axis < 3; ++Axis)
             {
-                if(OrbitTimes[Axis] == -1)
-                {
-                    bool Good = true;
-                    for(int Index = 0; Index < Count; ++Index)
-                    {
-                        if(Moons[Index].Pos[Axis] != InitialState[Index].Pos[Axis])
-                        {
-                            Good = false;
-                            break;
-                        }
-                    }
-                    if(Good)
-                    {
-                        OrbitTimes[Axis] = Tick + 1;
-                    }
-                }
+                Axes[Axis].Pos = realloc(Axes[Axis].Pos, sizeof(int) * Capacity);
             }
         }
+        Axes[0].Pos[Count] = X;
+        Axes[1].Pos[Count] = Y;
+        Axes[2].Pos[Count] = Z;
+        ++Count;
+    }
 
-        // Gravity
-        for(int A = 0; A < Count; ++A)
-        {
-            for(int B = 0; B < Count; ++B)
-            {
-                for(int Axis = 0; Axis < 3; ++Axis)
-                {
-                    if(Moons[A].Pos[Axis] < Moons[B].Pos[Axis])
-                    {
-                        ++Moons[A].Vel[Axis];
-                        --Moons[B].Vel[Axis];
-                    }
-                }
-            }
-        }
+    thrd_t Threads[3];
+    for(int Axis = 0; Axis < 3; ++Axis)
+    {
+        Axes[Axis].Count = Count;
+        Axes[Axis].Vel = calloc(Count, sizeof(int));
+        Axes[Axis].Initial = malloc(sizeof(int) * Count);
+        Axes[Axis].Keys = malloc(sizeof(unsigned long long) * Count);
+        memcpy(Axes[Axis].Initial, Axes[Axis].Pos, sizeof(int) * Count);
 
-        // Velocity
-        for(int Index = 0; Index < Count; ++Index)
+        if(thrd_create(&Threads[Axis], FindPeriod, &Axes[Axis]) != thrd_success)
         {
-            for(int Axis = 0; Axis < 3; ++Axis)
-            {
-                Moons[Index].Pos[Axis] += Moons[Index].Vel[Axis];
-            }
+            printf("Failed to start a worker\n");
+            return 1;
         }
-
-        ++Tick;
+    }
+    for(int Axis = 0; Axis < 3; ++Axis)
+    {
+        thrd_join(Threads[Axis], NULL);
     }
 
+    long long OrbitTimes[3] = {Axes[0].Period, Axes[1].Period, Axes[2].Period};
     printf("Orbit times: %4lld, %lld, %lld\n", OrbitTimes[0], OrbitTimes[1], OrbitTimes[2]);
 
     long long CommonOrbitTime = LCM(OrbitTimes[0], LCM(OrbitTimes[1], OrbitTimes[2]));
 
     printf("Result: %lld\n", CommonOrbitTime);
-}
\ No newline at end of file
+}
@@ -5,6 +5,7 @@
     ** 14 Dec 2019 Taipei **
 */
 
+#include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,6 +15,9 @@
 #define OPCODE_DEBUG 0
 #define SCREEN_WIDTH 48
 #define SCREEN_HEIGHT 24
+#define HEADLESS 1  // Track only the ball, paddle, blocks and score, no screen
+#define RENDER 0    // Draw tiles as they change with ANSI cursor moves
+#define LOOKAHEAD 1 // Predict where the ball lands instead of following it
 
 typedef long long icv;
 
@@ -52,6 +56,55 @@ enum pmodes
     M_REL = 2
 };
 
+enum interrupt
+{
+    INT_HLT = 0,
+    INT_IN  = 1,
+    INT_OUT = 2
+};
+
+enum flags
+{
+    F_HLT = 1,
+    F_IN  = 2
+};
+
+// Memory write recorded so a snapshot can be rolled back
+struct journal_entry
+{
+    int Address;
+    icv Value; // Value before the write
+};
+
+struct computer
+{
+    icv* Memory;
+    int IP;
+    int Rbase;
+    int Flags;
+    icv In;
+    icv Out[3]; // Output comes in (X, Y, ID) triples, Run yields once per triple
+    int OutLength;
+
+    // Writes are only journaled while a snapshot is live
+    int Snapshots;
+    struct journal_entry* Journal;
+    int JournalLength;
+    int JournalCapacity;
+};
+
+// Machine state at one point, the memory is rebuilt from the journal
+struct snapshot
+{
+    int IP;
+    int Rbase;
+    int Flags;
+    icv In;
+    icv Out[3];
+    int OutLength;
+    int JournalLength;
+};
+
 icv
 Pget(int Pmodes, int Pord, icv P, int Rbase, icv Memory[])
 {
@@ -96,33 +149,22 @@ Pget(int Pmodes, int Pord, icv P, int Rbase, icv Memory[])
     return Result;
 }
 
-void
-Pset(int Pmodes, int Pord, icv P, int Rbase, icv Memory[], icv Value)
+int
+Paddr(int Pmodes, int Pord, icv P, int Rbase)
 {
     int Pow10[] = {1, 10, 100};
     int Pmode = Pmodes / Pow10[Pord] % 10;
+    int Address;
     switch(Pmode)
     {
         case M_POS:
         {
-            int Address = P;
-            if(Address < 0 || Address >= MEMORY_SIZE)
-            {
-                printf("Bad address: %d\n", Address);
-                exit(1);
-            }
-            Memory[Address] = Value;
+            Address = P;
             break;
         }
         case M_REL:
         {
-            int Address = Rbase + P;
-            if(Address < 0 || Address >= MEMORY_SIZE)
-            {
-                printf("Bad address: %d\n", Address);
-                exit(1);
-            }
-            Memory[Address] = Value;
+            Address = Rbase + P;
             break;
         }
         default:
@@ -131,122 +173,57 @@ Pset(int Pmodes, int Pord, icv P, int Rbase, icv Memory[], icv Value)
             exit(1);
         }
     }
-}
-
-#define Load(void) Pget(Pmodes, Pord++, Memory[IP++], Rbase, Memory)
-#define Store(Value) Pset(Pmodes, Pord++, Memory[IP++], Rbase, Memory, (Value));
-
-enum mode
-{
-    MOD_X,
-    MOD_Y,
-    MOD_ID
-};
-
-enum tile
-{
-    TIL_EMPT = 0,
-    TIL_WALL = 1,
-    TIL_BLCK = 2,
-    TIL_HPAD = 3,
-    TIL_BALL = 4
-};
-
-enum joystick
-{
-    JOY_N = 0,
-    JOY_L = -1,
-    JOY_R = 1
-};
-
-int
-main(void)
-{
-    icv* Memory = malloc(sizeof(icv) * MEMORY_SIZE);
-    memset(Memory, 0, sizeof(icv) * MEMORY_SIZE);
-
-    FILE* Input = fopen("day13_input.txt", "r");
-    if(!Input)
+    if(Address < 0 || Address >= MEMORY_SIZE)
     {
-        puts("No program file\n");
-        return 1;
+        printf("Bad address: %d\n", Address);
+        exit(1);
     }
-    int Size = 0;
-    while(fscanf(Input, "%lld,", &Memory[Size]) != EOF)
-    {
-        Size++;
-    }
-
-    enum tile Tiles[SCREEN_WIDTH][SCREEN_HEIGHT] = {0};
-    enum mode Mode = MOD_X;
-    int R_X = 0;
-    int R_Y = 0;
-    int R_ID = 0;
-    int R_Score = 0;
-
-    Memory[0] = 2; // coins
-
-#if OPCODE_DEBUG
-    printf("%-4s %-3s %-3s %-4s\n", "IP", "OP", "PM", "RB");
-#endif
-
-    int PaddleX = 0;
-    int BallX = 0;
-    enum joystick Joystick = JOY_N;
+    return Address;
+}
 
-    int IP = 0;
-    int Rbase = 0;
-    for(;;)
+void
+Write(struct computer* Computer, int Address, icv Value)
+{
+    if(Computer->Snapshots > 0)
     {
-        // Bot
-
-        if(PaddleX < BallX)
-        {
-            Joystick = JOY_R;
-        }
-        else if(PaddleX > BallX)
+        if(Computer->JournalLength == Computer->JournalCapacity)
         {
-            Joystick = JOY_L;
-        }
-        else
-        {
-            Joystick = JOY_N;
-        }
-
-        // Screen
-
-        // TODO: I should really move the cursor and print a character on demand instead of printing
-        // the entire screen.
-
-#if 0
-        for(int Y = 0; Y < SCREEN_HEIGHT; ++Y)
-        {
-            for(int X = 0; X < SCREEN_WIDTH; ++X)
+            Computer->JournalCapacity = Computer->JournalCapacity ? Computer->JournalCapacity * 2 : 1024;
+            Computer->Journal = realloc(Computer->Journal, sizeof(struct journal_entry) * Computer->JournalCapacity);
+            if(!Computer->Journal)
             {
-                switch(Tiles[X][Y])
-                {
-                    case TIL_EMPT: putchar(' '); break;
-                    case TIL_WALL: putchar('|'); break;
-                    case TIL_BLCK: putchar('#'); break;
-                    case TIL_HPAD: putchar('-'); break;
-                    case TIL_BALL: putchar('O'); break;
-                }
+                printf("Out of memory for the journal\n");
+                exit(1);
             }
-            putchar('\n');
         }
+        Computer->Journal[Computer->JournalLength++] = (struct journal_entry){Address, Computer->Memory[Address]};
+    }
+    Computer->Memory[Address] = Value;
+}
 
-        printf("Score: %d\n", R_Score);
-#endif
+#define Load(void) Pget(Pmodes, Pord++, Computer->Memory[Computer->IP++], Computer->Rbase, Computer->Memory)
+#define Store(Value) Write(Computer, Paddr(Pmodes, Pord++, Computer->Memory[Computer->IP++], Computer->Rbase), (Value))
+#define Set(Flag) (Computer->Flags |= (Flag))
+#define Unset(Flag) (Computer->Flags &= ~(Flag))
+#define Test(Flag) ((Computer->Flags & (Flag)) == (Flag))
 
-        // Computer
+enum interrupt
+Run(struct computer* Computer)
+{
+    if(Test(F_HLT))
+    {
+        return INT_HLT;
+    }
 
-        int I = IP++;
-        int Opcode = Memory[I] % 100;
-        int Pmodes = Memory[I] / 100;
+    for(;;)
+    {
+        int I = Computer->IP++;
+        int Opcode = Computer->Memory[I] % 100;
+        int Pmodes = Computer->Memory[I] / 100;
         int Pord = 0;
 
 #if OPCODE_DEBUG
-        printf("%04d %-3s %03d %04d\n", IP, OPCODES[Opcode], Pmodes, Rbase);
+        printf("%04d %-3s %03d %04d\n", Computer->IP, OPCODES[Opcode], Pmodes, Computer->Rbase);
 #endif
 
         switch(Opcode)
@@ -267,48 +244,26 @@ main(void)
             }
             case OP_IN:
             {
-                Store(Joystick);
-                break;
-            }
-            case OP_OUT:
-            {
-                if(Mode == MOD_X)
+                if(Test(F_IN))
                 {
-                    R_X = Load();
-                    Mode = MOD_Y;
+                    Store(Computer->In);
+                    Unset(F_IN);
                 }
-                else if(Mode == MOD_Y)
+                else
                 {
-                    R_Y = Load();
-                    Mode = MOD_ID;
+                    --Computer->IP;
+                    Set(F_IN);
+                    return INT_IN;
                 }
-                else if(Mode == MOD_ID)
-                {
-                    if(R_X == -1 && R_Y == 0)
-                    {
-                        R_Score = Load();
-                    }
-                    else
-                    {
-                        R_ID = Load();
-
-                        if(R_ID == TIL_HPAD)
-                        {
-                            PaddleX = R_X;
-                        }
-                        if(R_ID == TIL_BALL)
-                        {
-                            BallX = R_X;
-                        }
-
-                        Tiles[R_X][R_Y] = R_ID;
-                    }
-                    Mode = MOD_X;
-                }
-                else
+                break;
+            }
+            case OP_OUT:
+            {
+                Computer->Out[Computer->OutLength++] = Load();
+                if(Computer->OutLength == 3)
                 {
-                    printf("Bad mode: %d\n", Mode);
-                    return 1;
+                    Computer->OutLength = 0;
+                    return INT_OUT;
                 }
                 break;
             }
@@ -318,7 +273,7 @@ main(void)
                 icv P2 = Load();
                 if(P1 != 0)
                 {
-                    IP = P2;
+                    Computer->IP = P2;
                 }
                 break;
             }
@@ -328,7 +283,7 @@ main(void)
                 icv P2 = Load();
                 if(P1 == 0)
                 {
-                    IP = P2;
+                    Computer->IP = P2;
                 }
                 break;
             }
@@ -348,19 +303,347 @@ main(void)
             }
             case OP_RBO:
             {
-                Rbase += Load();
+                Computer->Rbase += Load();
                 break;
             }
             case OP_HLT:
             {
-                printf("Halted\n");
-                printf("Result: %d\n", R_Score);
-                return 0;
+                Set(F_HLT);
+                return INT_HLT;
             }
             default:
             {
                 printf("Bad opcode: %d\n", Opcode);
-                return 1;
+                exit(1);
+            }
+        }
+    }
+}
+
+// Snapshots cost nothing up front, every write after one is journaled so
+// rolling back only touches what the speculative run changed
+
+struct snapshot
+TakeSnapshot(struct computer* Computer)
+{
+    ++Computer->Snapshots;
+    struct snapshot Snapshot = {
+        .IP = Computer->IP,
+        .Rbase = Computer->Rbase,
+        .Flags = Computer->Flags,
+        .In = Computer->In,
+        .OutLength = Computer->OutLength,
+        .JournalLength = Computer->JournalLength
+    };
+    memcpy(Snapshot.Out, Computer->Out, sizeof(Snapshot.Out));
+    return Snapshot;
+}
+
+// Roll back to a snapshot and release it, snapshots are released last to first
+void
+RestoreSnapshot(struct computer* Computer, struct snapshot Snapshot)
+{
+    while(Computer->JournalLength > Snapshot.JournalLength)
+    {
+        struct journal_entry Entry = Computer->Journal[--Computer->JournalLength];
+        Computer->Memory[Entry.Address] = Entry.Value;
+    }
+    Computer->IP = Snapshot.IP;
+    Computer->Rbase = Snapshot.Rbase;
+    Computer->Flags = Snapshot.Flags;
+    Computer->In = Snapshot.In;
+    memcpy(Computer->Out, Snapshot.Out, sizeof(Computer->Out));
+    Computer->OutLength = Snapshot.OutLength;
+    --Computer->Snapshots;
+}
+
+enum tile
+{
+    TIL_EMPT = 0,
+    TIL_WALL = 1,
+    TIL_BLCK = 2,
+    TIL_HPAD = 3,
+    TIL_BALL = 4
+};
+
+enum joystick
+{
+    JOY_N = 0,
+    JOY_L = -1,
+    JOY_R = 1
+};
+
+struct game
+{
+#if !HEADLESS
+    enum tile Tiles[SCREEN_WIDTH][SCREEN_HEIGHT];
+#endif
+    int BallX;
+    int BallY;
+    int PaddleX;
+    int PaddleY;
+    int Blocks;
+    int Score;
+    bool Started; // The first frame is drawn once the game asks for input
+    bool Landed;  // The ball reached the paddle row since the last prediction
+    int TargetX;  // Where the paddle waits for the ball to come down
+};
+
+#if RENDER
+void
+RenderTile(int X, int Y, enum tile Tile)
+{
+    const char Glyphs[] =
+    {
+        [TIL_EMPT] = ' ',
+        [TIL_WALL] = '|',
+        [TIL_BLCK] = '#',
+        [TIL_HPAD] = '-',
+        [TIL_BALL] = 'O'
+    };
+
+    // Move the cursor to the tile (ANSI rows and columns start at 1)
+    printf("\x1b[%d;%dH%c", Y + 1, X + 1, Glyphs[Tile]);
+}
+
+void
+RenderScore(int Score)
+{
+    printf("\x1b[%d;1HScore: %d\x1b[K", SCREEN_HEIGHT + 1, Score);
+}
+#endif
+
+void
+UpdateGame(struct game* Game, int X, int Y, int ID)
+{
+    if(X == -1 && Y == 0)
+    {
+        Game->Score = ID;
+#if RENDER
+        RenderScore(ID);
+#endif
+        return;
+    }
+
+    // Once the game runs the program clears the ball's and the paddle's old
+    // tile before it draws them again, so any other tile it clears held a
+    // block. Without a screen that's all there is to count blocks by, the
+    // screen build checks it against the tiles.
+    bool BrokeBlock = ID == TIL_EMPT && Game->Started &&
+                      !(X == Game->BallX && Y == Game->BallY) &&
+                      !(X == Game->PaddleX && Y == Game->PaddleY);
+
+#if HEADLESS
+    if(ID == TIL_BLCK)
+    {
+        ++Game->Blocks;
+    }
+    else if(BrokeBlock)
+    {
+        --Game->Blocks;
+    }
+#else
+    assert(!Game->Started || BrokeBlock == (ID == TIL_EMPT && Game->Tiles[X][Y] == TIL_BLCK));
+    (void)BrokeBlock;
+    Game->Blocks += (ID == TIL_BLCK) - (Game->Tiles[X][Y] == TIL_BLCK);
+    Game->Tiles[X][Y] = ID;
+#endif
+
+    if(ID == TIL_HPAD)
+    {
+        Game->PaddleX = X;
+        Game->PaddleY = Y;
+    }
+    if(ID == TIL_BALL)
+    {
+        Game->BallX = X;
+        Game->BallY = Y;
+        if(Y == Game->PaddleY - 1)
+        {
+            Game->Landed = true;
+        }
+    }
+
+#if RENDER
+    RenderTile(X, Y, ID);
+#endif
+}
+
+enum joystick
+MoveTowards(int PaddleX, int X)
+{
+    if(PaddleX < X)
+    {
+        return JOY_R;
+    }
+    else if(PaddleX > X)
+    {
+        return JOY_L;
+    }
+    return JOY_N;
+}
+
+// Play ahead until the ball comes down to the paddle row, then roll
+// everything back. The paddle makes its First move and then stands still.
+// Returns false if the ball is lost on the way, otherwise the column the
+// ball is in just before it lands and the joystick reads it takes to land.
+bool
+PredictLanding(struct computer* Computer, struct game* Game, enum joystick First, int* LandingX, int* Frames)
+{
+    struct snapshot Snapshot = TakeSnapshot(Computer);
+
+    // The game is waiting on the joystick
+    Computer->In = First;
+    *LandingX = Game->BallX;
+    *Frames = 0;
+
+    bool Landed = false;
+    bool Done = false;
+    while(!Done)
+    {
+        switch(Run(Computer))
+        {
+            case INT_HLT:
+            {
+                Done = true;
+                break;
+            }
+            case INT_IN:
+            {
+                Computer->In = JOY_N;
+                ++*Frames;
+                break;
+            }
+            case INT_OUT:
+            {
+                icv* Tile = Computer->Out;
+                if(Tile[2] == TIL_BALL)
+                {
+                    if(Tile[1] == Game->PaddleY - 1)
+                    {
+                        Landed = Done = true;
+                    }
+                    else
+                    {
+                        *LandingX = Tile[0];
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    RestoreSnapshot(Computer, Snapshot);
+    return Landed;
+}
+
+// Pick the move for the frame the ball bounces on, it changes where the ball
+// goes so every move is tried until the paddle can make it to the landing.
+// The paddle waits one column behind the ball and steps under it on the
+// bounce, the same way the simple bot catches it. Other bounces can leave the
+// ball in a loop that never reaches the last blocks.
+enum joystick
+PlanBounce(struct computer* Computer, struct game* Game)
+{
+    enum joystick Follow = MoveTowards(Game->PaddleX, Game->BallX);
+    enum joystick Moves[] = {Follow, -Follow, JOY_N};
+    if(Follow == JOY_N)
+    {
+        Moves[1] = JOY_L;
+        Moves[2] = JOY_R;
+    }
+    for(int I = 0; I < 3; ++I)
+    {
+        enum joystick Move = Moves[I];
+        int LandingX, Frames;
+        if(PredictLanding(Computer, Game, Move, &LandingX, &Frames) &&
+           abs(LandingX - (Game->PaddleX + Move)) <= Frames)
+        {
+            Game->TargetX = LandingX;
+            return Move;
+        }
+    }
+
+    // Nothing lands, the last block is gone or the ball is lost anyway
+    Game->TargetX = Game->BallX;
+    return MoveTowards(Game->PaddleX, Game->BallX);
+}
+
+int
+main(void)
+{
+    struct computer Computer = {0};
+    Computer.Memory = calloc(MEMORY_SIZE, sizeof(icv));
+
+    FILE* Input = fopen("day13_input.txt", "r");
+    if(!Input)
+    {
+        puts("No program file\n");
+        return 1;
+    }
+    int Size = 0;
+    while(fscanf(Input, "%lld,", &Computer.Memory[Size]) != EOF)
+    {
+        Size++;
+    }
+
+    struct game Game = {0};
+
+    Computer.Memory[0] = 2; // coins
+
+#if OPCODE_DEBUG
+    printf("%-4s %-3s %-3s %-4s\n", "IP", "OP", "PM", "RB");
+#endif
+
+#if RENDER
+    printf("\x1b[2J"); // Clear the screen once, tiles are drawn as they change
+#endif
+
+    int Predictions = 0;
+
+    for(;;)
+    {
+        switch(Run(&Computer))
+        {
+            case INT_HLT:
+            {
+#if RENDER
+                printf("\x1b[%d;1H", SCREEN_HEIGHT + 2);
+#endif
+                printf("Halted\n");
+                printf("Blocks left: %d\n", Game.Blocks);
+                printf("Predictions: %d\n", Predictions);
+                printf("Result: %d\n", Game.Score);
+                return 0;
+            }
+            case INT_IN:
+            {
+                // Bot, only consulted when the game reads the joystick
+
+#if LOOKAHEAD
+                // Frames between two bounces are idle, the landing spot
+                // doesn't change until the ball comes down again
+                if(!Game.Started || Game.Landed)
+                {
+                    Computer.In = PlanBounce(&Computer, &Game);
+                    ++Predictions;
+                    Game.Landed = false;
+                }
+                else
+                {
+                    Computer.In = MoveTowards(Game.PaddleX, Game.TargetX);
+                }
+#else
+                Computer.In = MoveTowards(Game.PaddleX, Game.BallX);
+#endif
+
+                Game.Started = true;
+                break;
+            }
+            case INT_OUT:
+            {
+                UpdateGame(&Game, Computer.Out[0], Computer.Out[1], Computer.Out[2]);
+                break;
             }
         }
     }
@@ -12,8 +12,10 @@
 #include <limits.h>
 
 #define MAX_CHEMICALS 1024
+#define MAX_INGREDIENTS (8 * MAX_CHEMICALS)
 #define ORE 0
 #define FUEL 1
+#define BISECT 1 // Bracket and bisect instead of the velocity climb
 
 enum parser_mode
 {
@@ -23,13 +25,34 @@ enum parser_mode
     O_NAME
 };
 
+struct ingredient
+{
+    int Chemical;
+    int Quantity;
+};
+
+// Inputs are a run in the shared ingredient list
 struct reaction
 {
-    int Inputs[MAX_CHEMICALS];
+    int FirstInput;
+    int InputCount;
     int OutputChemical;
     int OutputQuantity;
 };
 
+// Reactions compiled for costing. Every chemical has one producer, and the
+// order puts each chemical ahead of everything that goes into making it, so
+// one pass down the order settles every chemical once.
+struct chemistry
+{
+    int ChemicalCount;
+    int* Producer; // Reaction making each chemical, -1 for ORE
+    int* Order;
+    long long* Need; // Scratch for GetCost
+    struct reaction* Reactions;
+    struct ingredient* Ingredients;
+};
+
 int
 GetID(const char* Name, int* Count, char Names[][16])
 {
@@ -44,93 +67,188 @@ GetID(const char* Name, int* Count, char Names[][16])
     return (*Count)++;
 }
 
-struct reaction*
-GetReaction(int Chemical, int Count, struct reaction Reactions[])
+void
+PrintReaction(struct reaction* Reaction, struct ingredient Ingredients[], char Names[][16])
+{
+    for(int Index = 0;
+        Index < Reaction->InputCount;
+        ++Index)
+    {
+        struct ingredient* Input = &Ingredients[Reaction->FirstInput + Index];
+        printf("%s%d %s", Index ? ", " : "", Input->Quantity, Names[Input->Chemical]);
+    }
+    printf(" => %d %s\n", Reaction->OutputQuantity, Names[Reaction->OutputChemical]);
+}
+
+// Depth first from Chemical, it goes in the order after everything it's made
+// into has been visited, so the order comes out reversed
+void
+VisitChemical(struct chemistry* Chemistry, int Chemical, char* Marks, int* Position, char Names[][16])
+{
+    if(Marks[Chemical] == 2)
+    {
+        return;
+    }
+    if(Marks[Chemical] == 1)
+    {
+        printf("Reactions loop through %s\n", Names[Chemical]);
+        exit(1);
+    }
+    Marks[Chemical] = 1;
+
+    int ReactionIndex = Chemistry->Producer[Chemical];
+    if(ReactionIndex >= 0)
+    {
+        struct reaction* Reaction = &Chemistry->Reactions[ReactionIndex];
+        for(int Index = 0;
+            Index < Reaction->InputCount;
+            ++Index)
+        {
+            VisitChemical(Chemistry, Chemistry->Ingredients[Reaction->FirstInput + Index].Chemical, Marks, Position, Names);
+        }
+    }
+    else if(Chemical != ORE)
+    {
+        printf("No reaction available for %s\n", Names[Chemical]);
+        exit(1);
+    }
+
+    Marks[Chemical] = 2;
+    Chemistry->Order[--*Position] = Chemical;
+}
+
+struct chemistry
+CompileReactions(int ChemicalCount, char Names[][16], int ReactionCount, struct reaction Reactions[], struct ingredient Ingredients[])
 {
-    for(int Index = 0; Index < Count; ++Index)
+    struct chemistry Chemistry =
+    {
+        .ChemicalCount = ChemicalCount,
+        .Producer = malloc(sizeof(int) * ChemicalCount),
+        .Order = malloc(sizeof(int) * ChemicalCount),
+        .Need = malloc(sizeof(long long) * ChemicalCount),
+        .Reactions = Reactions,
+        .Ingredients = Ingredients
+    };
+
+    for(int Chemical = 0; Chemical < ChemicalCount; ++Chemical)
+    {
+        Chemistry.Producer[Chemical] = -1;
+    }
+    for(int Index = 0; Index < ReactionCount; ++Index)
     {
-        if(Reactions[Index].OutputChemical == Chemical)
+        int Chemical = Reactions[Index].OutputChemical;
+        if(Chemistry.Producer[Chemical] >= 0)
         {
-            return &Reactions[Index];
+            printf("More than one reaction makes %s\n", Names[Chemical]);
+            exit(1);
         }
+        Chemistry.Producer[Chemical] = Index;
     }
-    return NULL;
+
+    // Chemicals nothing needs still go in the order, they just never get costed
+    char* Marks = calloc(ChemicalCount, 1);
+    int Position = ChemicalCount;
+    for(int Chemical = 0; Chemical < ChemicalCount; ++Chemical)
+    {
+        VisitChemical(&Chemistry, Chemical, Marks, &Position, Names);
+    }
+    free(Marks);
+
+    return Chemistry;
 }
 
-void
-PrintReaction(struct reaction* Reaction, int Count, char Names[][16])
+// ORE needed for Quantity of Chemical. By the time a chemical comes up in
+// the order everything that uses it has asked for its share, so it's made in
+// one go and each ingredient is touched once. Costs past LLONG_MAX come back
+// as LLONG_MAX.
+long long
+GetCost(struct chemistry* Chemistry, int Chemical, long long Quantity)
 {
-    bool FirstInput = true;
+    memset(Chemistry->Need, 0, sizeof(long long) * Chemistry->ChemicalCount);
+    Chemistry->Need[Chemical] = Quantity;
+
     for(int Index = 0;
-        Index < Count;
+        Index < Chemistry->ChemicalCount;
         ++Index)
     {
-        if(Reaction->Inputs[Index] != 0)
+        int Missing = Chemistry->Order[Index];
+        long long Need = Chemistry->Need[Missing];
+        if(Missing == ORE || Need <= 0)
+        {
+            continue;
+        }
+
+        struct reaction* Reaction = &Chemistry->Reactions[Chemistry->Producer[Missing]];
+        long long ReactionNumber = Need / Reaction->OutputQuantity + (Need % Reaction->OutputQuantity != 0);
+
+        for(int Input = 0;
+            Input < Reaction->InputCount;
+            ++Input)
         {
-            if (!FirstInput)
+            struct ingredient* Ingredient = &Chemistry->Ingredients[Reaction->FirstInput + Input];
+            long long* Total = &Chemistry->Need[Ingredient->Chemical];
+            if(ReactionNumber > (LLONG_MAX - *Total) / Ingredient->Quantity)
             {
-                printf(", ");
+                *Total = LLONG_MAX;
             }
             else
             {
-                FirstInput = false;
+                *Total += Ingredient->Quantity * ReactionNumber;
             }
-            printf("%d %s", Reaction->Inputs[Index], Names[Index]);
         }
     }
-    printf(" => %d %s\n", Reaction->OutputQuantity, Names[Reaction->OutputChemical]);
+
+    return Chemistry->Need[ORE];
 }
 
+// Most FUEL that OreBudget pays for. Cost only grows with fuel, and making
+// the one fuel batch N times over never costs less than making N together,
+// so Budget / Cost(1) is always affordable. The top of the bracket doubles
+// from there until it isn't, then the bracket is halved with one GetCost a
+// step. High stops doubling at LLONG_MAX, so that's a few dozen calls for
+// any budget that fits in a long long.
 long long
-GetCost(int Chemical, long long Quantity, int ChemicalCount, char Names[][16], int ReactionCount, struct reaction Reactions[])
+MaxFuel(struct chemistry* Chemistry, long long OreBudget, long long CostOfOne, int* Evaluations)
 {
-    long long Stash[MAX_CHEMICALS] = {0};
-    Stash[Chemical] = -Quantity;
-
-    bool Done = false;
-    while(!Done)
+    if(CostOfOne > OreBudget)
     {
-        Done = true;
-        for(int MissingChemical = 0;
-            MissingChemical < ChemicalCount;
-            ++MissingChemical)
-        {
-            // Chemical is an ORE or not missing
-            if(MissingChemical == ORE || Stash[MissingChemical] >= 0)
-            {
-                continue;
-            }
-
-            // Chemical is still missing
-            Done = false;
+        return 0;
+    }
 
-            // Reaction to use
-            struct reaction* Reaction = GetReaction(MissingChemical, ReactionCount, Reactions);
-            if(!Reaction)
-            {
-                printf("No reaction available for %s\n", Names[MissingChemical]);
-                exit(1);
-            }
+    // A saturated cost would pass for LLONG_MAX itself
+    if(OreBudget == LLONG_MAX)
+    {
+        --OreBudget;
+    }
 
-            // Number of reactions to perform
-            long long ReactionNumber = -Stash[MissingChemical] / Reaction->OutputQuantity;
-            if(-Stash[MissingChemical] % Reaction->OutputQuantity != 0)
-            {
-                ++ReactionNumber;
-            }
+    long long Low = OreBudget / CostOfOne;
+    long long High = Low <= LLONG_MAX / 2 ? Low * 2 : LLONG_MAX;
+    while(++*Evaluations, GetCost(Chemistry, FUEL, High) <= OreBudget)
+    {
+        if(High == LLONG_MAX)
+        {
+            return High;
+        }
+        Low = High;
+        High = High <= LLONG_MAX / 2 ? High * 2 : LLONG_MAX;
+    }
 
-            // Perform the reactions
-            Stash[MissingChemical] += Reaction->OutputQuantity * ReactionNumber;
-            for(int InputChemical = 0;
-                InputChemical < ChemicalCount;
-                ++InputChemical)
-            {
-                Stash[InputChemical] -= Reaction->Inputs[InputChemical] * ReactionNumber;
-            }
+    // Low is affordable, High isn't
+    while(High - Low > 1)
+    {
+        long long Middle = Low + (High - Low) / 2;
+        ++*Evaluations;
+        if(GetCost(Chemistry, FUEL, Middle) <= OreBudget)
+        {
+            Low = Middle;
+        }
+        else
+        {
+            High = Middle;
         }
     }
 
-    return -Stash[ORE];
+    return Low;
 }
 
 static inline long long
@@ -146,6 +264,8 @@ main(void)
     int Count = 2;
     struct reaction Reactions[MAX_CHEMICALS] = {0};
     int ReactionCount = 0;
+    static struct ingredient Ingredients[MAX_INGREDIENTS];
+    int IngredientCount = 0;
 
     // Read input
     {
@@ -178,8 +298,17 @@ main(void)
                     {
                         Token[--Length] = '\0';
                     }
-                    int ID = GetID(Token, &Count, Names);
-                    Reaction.Inputs[ID] = Quantity;
+                    if(IngredientCount == MAX_INGREDIENTS)
+                    {
+                        printf("Too many ingredients\n");
+                        exit(1);
+                    }
+                    if(Reaction.InputCount == 0)
+                    {
+                        Reaction.FirstInput = IngredientCount;
+                    }
+                    Ingredients[IngredientCount++] = (struct ingredient){GetID(Token, &Count, Names), Quantity};
+                    ++Reaction.InputCount;
                     ParserMode = I_SOAR;
                     break;
                 }
@@ -204,34 +333,28 @@ main(void)
         fclose(Input);
     }
 
-    // for(int A = 0; A < ReactionCount; ++A)
-    // {
-    //     for(int B = 0; B < ReactionCount; ++B)
-    //     {
-    //         if(A != B && Reactions[A].OutputChemical == Reactions[B].OutputChemical)
-    //         {
-    //             printf("Reactions don't have unique results!\n");
-    //             exit(1);
-    //         }
-    //     }
-    // }
-    // printf("Reactions are unique!\n");
-
-
     // for(int ReactionIndex = 0;
     //     ReactionIndex < ReactionCount;
     //     ++ReactionIndex)
     // {
-    //     PrintReaction(&Reactions[ReactionIndex], Count, Names);
+    //     PrintReaction(&Reactions[ReactionIndex], Ingredients, Names);
     // }
 
+    struct chemistry Chemistry = CompileReactions(Count, Names, ReactionCount, Reactions, Ingredients);
+
     long long TargetCost = 1000000000000;
+#if BISECT
+    int Evaluations = 1;
+    long long CostOfOne = GetCost(&Chemistry, FUEL, 1);
+    long long Guess = MaxFuel(&Chemistry, TargetCost, CostOfOne, &Evaluations);
+    printf("Evaluations: %d\n", Evaluations);
+#else
     long long Guess = 1;
     long double GuessVelocity = 1.0;
     for(;;)
     {
-        long long Cost = GetCost(FUEL, Guess, Count, Names, ReactionCount, Reactions);
-        long long CostAtGuessPlusOne = GetCost(FUEL, Guess+1, Count, Names, ReactionCount, Reactions);
+        long long Cost = GetCost(&Chemistry, FUEL, Guess);
+        long long CostAtGuessPlusOne = GetCost(&Chemistry, FUEL, Guess+1);
         
         printf("G=%lld, C(G)=%lld, C(G+1)=%lld, V=%Lf\n", Guess, Cost, CostAtGuessPlusOne, GuessVelocity);
 
@@ -267,6 +390,7 @@ main(void)
             Guess = Max(Guess + GuessVelocity, 1);
         }
     }
+#endif
 
     printf("Result: %lld\n", Guess);
 }
\ No newline at end of file
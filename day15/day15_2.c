@@ -9,6 +9,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+
+#define FORK 1 // Explore from computer snapshots instead of walking back
+#define THREAD_COUNT 8
 
 // Computer
 
@@ -329,14 +333,32 @@ enum tiletype
     TIL_NEXP = 0, // not explored
     TIL_EMPT = 1, // empty
     TIL_WALL = 2, // wall
-    TIL_OXYS = 3  // oxygen system
+    TIL_OXYS = 3, // oxygen system
+    TIL_PEND = 4  // a droid is on its way
 };
 
 struct tile
 {
     enum tiletype Type;
-    struct vec Position;
-    int Distance;
+    bool Filled; // Oxygen got here
+};
+
+// Tiles in a grid centered on the start, it doubles whenever the droid
+// wanders off its edge
+struct map
+{
+    struct tile* Tiles;
+    struct vec Origin; // Where (0,0) is in the grid
+    int Width;
+    int Height;
+};
+
+// Moves back to the start, popped as the droid backtracks
+struct path
+{
+    enum mvcmd* Moves;
+    int Count;
+    int Capacity;
 };
 
 enum search
@@ -357,26 +379,75 @@ Max(int A, int B)
     return A > B ? A : B;
 }
 
+bool
+InMap(struct map* Map, struct vec Position)
+{
+    int X = Position.X + Map->Origin.X;
+    int Y = Position.Y + Map->Origin.Y;
+    return X >= 0 && X < Map->Width && Y >= 0 && Y < Map->Height;
+}
+
+// Double the grid until the position fits, the old tiles stay in the middle
+void
+GrowMap(struct map* Map, struct vec Position)
+{
+    int Width = Map->Width;
+    int Height = Map->Height;
+    struct vec Origin = Map->Origin;
+    if(!Map->Tiles)
+    {
+        Width = Height = 64;
+        Origin = (struct vec){Width / 2, Height / 2};
+    }
+    while(Position.X + Origin.X < 0 || Position.X + Origin.X >= Width)
+    {
+        Origin.X += Width / 2;
+        Width *= 2;
+    }
+    while(Position.Y + Origin.Y < 0 || Position.Y + Origin.Y >= Height)
+    {
+        Origin.Y += Height / 2;
+        Height *= 2;
+    }
+
+    struct tile* Tiles = calloc((size_t)Width * Height, sizeof(struct tile));
+    for(int Y = 0; Y < Map->Height; ++Y)
+    {
+        int NewX = Origin.X - Map->Origin.X;
+        int NewY = Origin.Y - Map->Origin.Y + Y;
+        memcpy(&Tiles[NewY * Width + NewX], &Map->Tiles[Y * Map->Width], sizeof(struct tile) * Map->Width);
+    }
+    free(Map->Tiles);
+
+    Map->Tiles = Tiles;
+    Map->Origin = Origin;
+    Map->Width = Width;
+    Map->Height = Height;
+}
+
+// Tiles the droid hasn't seen yet come back as not explored, the pointer is
+// good until the next lookup that grows the map
 struct tile*
-GetTile(int* Count, struct tile Tiles[], struct vec Position)
+GetTile(struct map* Map, struct vec Position)
 {
-    for(int Index = 0;
-        Index < *Count;
-        ++Index)
+    if(!InMap(Map, Position))
     {
-        if(Tiles[Index].Position.X == Position.X && Tiles[Index].Position.Y == Position.Y)
-        {
-            return &Tiles[Index];
-        }
+        GrowMap(Map, Position);
     }
-    struct tile* Tile = &Tiles[(*Count)++];
-    *Tile = (struct tile)
+    int X = Position.X + Map->Origin.X;
+    int Y = Position.Y + Map->Origin.Y;
+    return &Map->Tiles[Y * Map->Width + X];
+}
+
+void
+PushPath(struct path* Path, enum mvcmd MovementCommand)
+{
+    if(Path->Count == Path->Capacity)
     {
-        .Type = TIL_NEXP,
-        .Position = Position,
-        .Distance = 0
-    };
-    return Tile;
+        Path->Capacity = Path->Capacity ? Path->Capacity * 2 : 1024;
+        Path->Moves = realloc(Path->Moves, sizeof(enum mvcmd) * Path->Capacity);
+    }
+    Path->Moves[Path->Count++] = MovementCommand;
 }
 
 enum mvcmd
@@ -404,20 +475,20 @@ GetPositionAfterMove(struct vec Position, enum mvcmd MoveCommand)
 }
 
 enum mvcmd
-DroidPickPath(struct vec* Position, int* PathCount, enum mvcmd Path[], int* TileCount, struct tile Tiles[])
+DroidPickPath(struct vec* Position, struct path* Path, struct map* Map)
 {
     for(enum mvcmd MovementCommand = MV_NORTH;
         MovementCommand <= MV_EAST;
         ++MovementCommand)
     {
-        if(GetTile(TileCount, Tiles, GetPositionAfterMove(*Position, MovementCommand))->Type == TIL_NEXP)
+        if(GetTile(Map, GetPositionAfterMove(*Position, MovementCommand))->Type == TIL_NEXP)
         {
             return MovementCommand;
         }
     }
-    if(*PathCount > 0)
+    if(Path->Count > 0)
     {
-        return Opposite(Path[(*PathCount)-1]);
+        return Opposite(Path->Moves[Path->Count-1]);
     }
     else
     {
@@ -426,72 +497,286 @@ DroidPickPath(struct vec* Position, int* PathCount, enum mvcmd Path[], int* Tile
 }
 
 void
-DroidMove(struct vec* Position, enum mvcmd MovementCommand, enum status Status, int* PathCount, enum mvcmd Path[], int* TileCount, struct tile Tiles[])
+DroidMove(struct vec* Position, enum mvcmd MovementCommand, enum status Status, struct path* Path, struct map* Map)
 {
     struct vec PositionAfterMove = GetPositionAfterMove(*Position, MovementCommand);
     switch(Status)
     {
         case ST_WALL:
         {
-            GetTile(TileCount, Tiles, PositionAfterMove)->Type = TIL_WALL;
+            GetTile(Map, PositionAfterMove)->Type = TIL_WALL;
             break;
         }
         case ST_MVEM:
         {
-            GetTile(TileCount, Tiles, PositionAfterMove)->Type = TIL_EMPT;
+            GetTile(Map, PositionAfterMove)->Type = TIL_EMPT;
             *Position = PositionAfterMove;
-            if(*PathCount > 0 && MovementCommand == Opposite(Path[(*PathCount)-1]))
+            if(Path->Count > 0 && MovementCommand == Opposite(Path->Moves[Path->Count-1]))
             {
-                --(*PathCount);
+                --Path->Count;
             }
             else
             {
-                Path[(*PathCount)++] = MovementCommand;
+                PushPath(Path, MovementCommand);
             }
             break;
         }
         case ST_MVOX:
         {
-            GetTile(TileCount, Tiles, PositionAfterMove)->Type = TIL_OXYS;
+            GetTile(Map, PositionAfterMove)->Type = TIL_OXYS;
             *Position = PositionAfterMove;
-            if(*PathCount > 0 && MovementCommand == Opposite(Path[(*PathCount)-1]))
+            if(Path->Count > 0 && MovementCommand == Opposite(Path->Moves[Path->Count-1]))
+            {
+                --Path->Count;
+            }
+            else
+            {
+                PushPath(Path, MovementCommand);
+            }
+            break;
+        }
+    }
+}
+
+// Forked exploration
+//
+// Every droid waits on an explored tile with its own copy of the computer.
+// It tries each unexplored neighbour once, and a droid that gets through is
+// left there as a new branch, so the explorer never sends a move back.
+
+// A droid waiting on an explored tile for its next move
+struct branch
+{
+    struct computer Computer;
+    struct vec Position;
+};
+
+struct explorer
+{
+    mtx_t Lock; // Guards everything below
+    cnd_t Wake;
+
+    struct map Map;
+    struct vec OxygenPosition;
+    int Moves;
+
+    struct branch** Branches; // Stack of branches waiting to be explored
+    int BranchCount;
+    int BranchCapacity;
+    int Busy; // Workers exploring a branch, they can still add more
+};
+
+// Send one move and wait for the status
+enum status
+SendMove(struct computer* Computer, enum mvcmd MovementCommand)
+{
+    if(Run(Computer) != INT_IN)
+    {
+        printf("Droid stopped taking moves\n");
+        exit(1);
+    }
+    Computer->In = MovementCommand;
+    if(Run(Computer) != INT_OUT)
+    {
+        printf("Droid gave no status\n");
+        exit(1);
+    }
+    return Computer->Out;
+}
+
+void
+PushBranch(struct explorer* Explorer, struct branch* Branch)
+{
+    if(Explorer->BranchCount == Explorer->BranchCapacity)
+    {
+        Explorer->BranchCapacity = Explorer->BranchCapacity ? Explorer->BranchCapacity * 2 : 64;
+        Explorer->Branches = realloc(Explorer->Branches, sizeof(struct branch*) * Explorer->BranchCapacity);
+    }
+    Explorer->Branches[Explorer->BranchCount++] = Branch;
+}
+
+// Try every neighbour nobody else has claimed. A droid that hits a wall
+// hasn't moved, so it's reused for the next neighbour and only droids that
+// get through cost a copy. The last neighbour gets the branch's own droid.
+void
+ExploreBranch(struct explorer* Explorer, struct branch* Branch)
+{
+    enum mvcmd Claimed[4];
+    int ClaimedCount = 0;
+
+    mtx_lock(&Explorer->Lock);
+    for(enum mvcmd MovementCommand = MV_NORTH;
+        MovementCommand <= MV_EAST;
+        ++MovementCommand)
+    {
+        struct tile* Tile = GetTile(&Explorer->Map, GetPositionAfterMove(Branch->Position, MovementCommand));
+        if(Tile->Type == TIL_NEXP)
+        {
+            Tile->Type = TIL_PEND;
+            Claimed[ClaimedCount++] = MovementCommand;
+        }
+    }
+    mtx_unlock(&Explorer->Lock);
+
+    struct branch* Spare = 0; // Hit a wall, still on the branch's tile
+    bool BranchUsed = false;
+
+    for(int Index = 0;
+        Index < ClaimedCount;
+        ++Index)
+    {
+        struct branch* Droid = Spare;
+        if(!Droid)
+        {
+            if(Index == ClaimedCount - 1)
             {
-                --(*PathCount);
+                Droid = Branch;
+                BranchUsed = true;
             }
             else
             {
-                Path[(*PathCount)++] = MovementCommand;
+                Droid = malloc(sizeof(struct branch));
+                *Droid = *Branch;
+            }
+        }
+        Spare = 0;
+
+        struct vec PositionAfterMove = GetPositionAfterMove(Branch->Position, Claimed[Index]);
+        enum status Status = SendMove(&Droid->Computer, Claimed[Index]);
+
+        mtx_lock(&Explorer->Lock);
+        ++Explorer->Moves;
+        struct tile* Tile = GetTile(&Explorer->Map, PositionAfterMove);
+        switch(Status)
+        {
+            case ST_WALL:
+            {
+                Tile->Type = TIL_WALL;
+                Spare = Droid;
+                break;
+            }
+            case ST_MVEM:
+            case ST_MVOX:
+            {
+                Tile->Type = Status == ST_MVOX ? TIL_OXYS : TIL_EMPT;
+                if(Status == ST_MVOX)
+                {
+                    Explorer->OxygenPosition = PositionAfterMove;
+                }
+                Droid->Position = PositionAfterMove;
+                PushBranch(Explorer, Droid);
+                cnd_signal(&Explorer->Wake);
+                break;
             }
+        }
+        mtx_unlock(&Explorer->Lock);
+    }
+
+    free(Spare);
+    if(!BranchUsed)
+    {
+        free(Branch);
+    }
+}
+
+int
+ExploreBranches(void* Data)
+{
+    struct explorer* Explorer = Data;
+
+    mtx_lock(&Explorer->Lock);
+    for(;;)
+    {
+        while(Explorer->BranchCount == 0 && Explorer->Busy > 0)
+        {
+            cnd_wait(&Explorer->Wake, &Explorer->Lock);
+        }
+        if(Explorer->BranchCount == 0)
+        {
+            // Nothing left and nobody exploring who could add more
             break;
         }
+
+        struct branch* Branch = Explorer->Branches[--Explorer->BranchCount];
+        ++Explorer->Busy;
+        mtx_unlock(&Explorer->Lock);
+
+        ExploreBranch(Explorer, Branch);
+
+        mtx_lock(&Explorer->Lock);
+        --Explorer->Busy;
+        if(Explorer->Busy == 0 && Explorer->BranchCount == 0)
+        {
+            cnd_broadcast(&Explorer->Wake);
+        }
     }
+    mtx_unlock(&Explorer->Lock);
+
+    return 0;
 }
 
-#define MAX_PATH (16 * 1024)
-#define MAX_TILES (16 * 1024)
+// Map everything reachable from the droid's start
+void
+Explore(struct explorer* Explorer, struct computer* Computer)
+{
+    mtx_init(&Explorer->Lock, mtx_plain);
+    cnd_init(&Explorer->Wake);
+
+    GetTile(&Explorer->Map, (struct vec){0,0})->Type = TIL_EMPT;
+
+    struct branch* Root = malloc(sizeof(struct branch));
+    Root->Computer = *Computer;
+    Root->Position = (struct vec){0,0};
+    PushBranch(Explorer, Root);
+
+    thrd_t Threads[THREAD_COUNT];
+    for(int Index = 0; Index < THREAD_COUNT; ++Index)
+    {
+        if(thrd_create(&Threads[Index], ExploreBranches, Explorer) != thrd_success)
+        {
+            printf("Failed to start a worker\n");
+            exit(1);
+        }
+    }
+    for(int Index = 0; Index < THREAD_COUNT; ++Index)
+    {
+        thrd_join(Threads[Index], NULL);
+    }
+
+    free(Explorer->Branches);
+    cnd_destroy(&Explorer->Wake);
+    mtx_destroy(&Explorer->Lock);
+}
 
 int
 main(void)
 {
     struct computer Computer = {0};
-    struct vec Position = {0,0};
-    enum mvcmd MovementCommand = MV_NORTH;
     enum status Status = 0;
-    enum mvcmd Path[MAX_PATH] = {0};
-    int PathCount = 0;
-    struct tile Tiles[MAX_TILES] = {0};
-    int TileCount = 0;
-    struct vec DrawMin = {-3,-3};
-    struct vec DrawMax = {3,3};
+    struct map Map = {0};
     struct vec OxygenPosition = {0};
-    bool OxygenFound = false;
+
+    LoadMemory("day15_input.txt", Computer.Memory);
 
     // Map
 
-    GetTile(&TileCount, Tiles, (struct vec){0,0})->Type = TIL_EMPT;
+#if FORK
+    struct explorer Explorer = {0};
+    Explore(&Explorer, &Computer);
+    Map = Explorer.Map;
+    OxygenPosition = Explorer.OxygenPosition;
+    printf("Moves: %d\n", Explorer.Moves);
+#else
+    struct vec Position = {0,0};
+    enum mvcmd MovementCommand = MV_NORTH;
+    struct path Path = {0};
+    struct vec DrawMin = {-3,-3};
+    struct vec DrawMax = {3,3};
+    bool OxygenFound = false;
 
-    LoadMemory("day15_input.txt", Computer.Memory);
+    GetTile(&Map, (struct vec){0,0})->Type = TIL_EMPT;
 
+    int Moves = 0;
     while(!(OxygenFound && Position.X == 0 && Position.Y == 0))
     {
         enum interrupt Interrupt = Run(&Computer);
@@ -499,14 +784,15 @@ main(void)
         {
             case INT_IN:
             {
-                MovementCommand = DroidPickPath(&Position, &PathCount, Path, &TileCount, Tiles);
+                MovementCommand = DroidPickPath(&Position, &Path, &Map);
                 Computer.In = MovementCommand;
+                ++Moves;
                 break;
             }
             case INT_OUT:
             {
                 enum status Status = Computer.Out;
-                DroidMove(&Position, MovementCommand, Status, &PathCount, Path, &TileCount, Tiles);
+                DroidMove(&Position, MovementCommand, Status, &Path, &Map);
                 if(Status == 2)
                 {
                     OxygenPosition = Position;
@@ -530,38 +816,50 @@ main(void)
             }
         }
     }
+    printf("Moves: %d\n", Moves);
+#endif
 
-    // Distance to each tile (from the oxygen system)
+    // Oxygen spreads one step a minute, each pass fills the frontier's
+    // neighbours and they become the next frontier
 
-    int MaxDistance = 0;
+    int MapSize = Map.Width * Map.Height;
+    struct vec* Frontier = malloc(sizeof(struct vec) * MapSize);
+    struct vec* NextFrontier = malloc(sizeof(struct vec) * MapSize);
+    int FrontierCount = 0;
 
-    struct tile* Stack[MAX_TILES] = {0};
-    int StackSize = 0;
+    GetTile(&Map, OxygenPosition)->Filled = true;
+    Frontier[FrontierCount++] = OxygenPosition;
 
-    Stack[StackSize++] = GetTile(&TileCount, Tiles, OxygenPosition);
-
-    while(StackSize > 0)
+    int Minutes = -1;
+    while(FrontierCount > 0)
     {
-        struct tile* Tile = Stack[--StackSize];
-
-        for(enum mvcmd MovementCommand = MV_NORTH;
-            MovementCommand <= MV_EAST;
-            ++MovementCommand)
+        int NextFrontierCount = 0;
+        for(int Index = 0;
+            Index < FrontierCount;
+            ++Index)
         {
-            struct tile* Neighbour = GetTile(&TileCount, Tiles, GetPositionAfterMove(Tile->Position, MovementCommand));
-
-            if(Neighbour->Type != TIL_WALL && Neighbour->Distance == 0)
+            for(enum mvcmd MovementCommand = MV_NORTH;
+                MovementCommand <= MV_EAST;
+                ++MovementCommand)
             {
-                Neighbour->Distance = Tile->Distance + 1;
-                Stack[StackSize++] = Neighbour;
+                struct vec Position = GetPositionAfterMove(Frontier[Index], MovementCommand);
 
-                if(Neighbour->Distance > MaxDistance)
+                // Everything reachable was explored so the fill never leaves the map
+                struct tile* Neighbour = GetTile(&Map, Position);
+                if(Neighbour->Type != TIL_WALL && Neighbour->Type != TIL_NEXP && !Neighbour->Filled)
                 {
-                    MaxDistance = Neighbour->Distance;
+                    Neighbour->Filled = true;
+                    NextFrontier[NextFrontierCount++] = Position;
                 }
             }
         }
+
+        struct vec* Swap = Frontier;
+        Frontier = NextFrontier;
+        NextFrontier = Swap;
+        FrontierCount = NextFrontierCount;
+        ++Minutes;
     }
 
-    printf("Result: %d\n", MaxDistance);
+    printf("Result: %d\n", Minutes);
 }
@@ -6,60 +6,74 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 
-int main(void)
+// One phase without a pattern matrix. Output digit Round repeats each base
+// pattern value Round+1 times, so its sum is the +1 runs minus the -1 runs,
+// each run a difference of two prefix sums. Round R has about Count/R runs,
+// so a phase is O(Count log Count).
+void
+RunPhase(int* Signal, int* Prefix, int Count)
 {
-    int Signal[1024] = {0};
-    int Count = 0;
-
-    FILE* File = fopen("day16_input.txt", "r");
-    while(fscanf(File, "%1d", &Signal[Count]) != EOF)
+    Prefix[0] = 0;
+    for(int Index = 0;
+        Index < Count;
+        ++Index)
     {
-        ++Count;
+        Prefix[Index+1] = Prefix[Index] + Signal[Index];
     }
 
-    int BasePattern[] = {0, 1, 0, -1};
-
-    int Pattern[1024][1024] = {0};
     for(int Round = 0;
         Round < Count;
         ++Round)
     {
-        for(int Position = 0;
-            Position < Count;
-            ++Position)
+        int Length = Round + 1;
+        int Sum = 0;
+
+        // The pattern is shifted left by one, the first +1 run starts at Round
+        for(int Start = Round;
+            Start < Count;
+            Start += 4 * Length)
         {
-            Pattern[Round][Position] = BasePattern[((Position+1) / (Round+1)) % 4];
+            int End = Start + Length < Count ? Start + Length : Count;
+            Sum += Prefix[End] - Prefix[Start];
+
+            int NegativeStart = Start + 2 * Length;
+            if(NegativeStart < Count)
+            {
+                int NegativeEnd = NegativeStart + Length < Count ? NegativeStart + Length : Count;
+                Sum -= Prefix[NegativeEnd] - Prefix[NegativeStart];
+            }
         }
+
+        // The prefix sums hold the whole input, the signal can be overwritten
+        Signal[Round] = abs(Sum % 10);
     }
+}
+
+int main(void)
+{
+    int Capacity = 1024;
+    int* Signal = malloc(sizeof(int) * Capacity);
+    int Count = 0;
+
+    FILE* File = fopen("day16_input.txt", "r");
+    while(fscanf(File, "%1d", &Signal[Count]) != EOF)
+    {
+        if(++Count == Capacity)
+        {
+            Capacity *= 2;
+            Signal = realloc(Signal, sizeof(int) * Capacity);
+        }
+    }
+
+    int* Prefix = malloc(sizeof(int) * (Count + 1));
 
     for(int Phase = 0;
         Phase < 100;
         ++Phase)
     {
-        int Output[1024] = {0};
-        for(int Round = 0;
-            Round < Count;
-            ++Round)
-        {
-            for(int Position = 0;
-                Position < Count;
-                ++Position)
-            {
-                Output[Round] += Signal[Position] * Pattern[Round][Position];
-            }
-            Output[Round] %= 10;
-            if(Output[Round] < 0)
-            {
-                Output[Round] *= -1;
-            }
-        }
-        for(int Index = 0;
-            Index < Count;
-            ++Index)
-        {
-            Signal[Index] = Output[Index];
-        }
+        RunPhase(Signal, Prefix, Count);
     }
 
     for(int Index = 0;
@@ -69,4 +83,4 @@ int main(void)
         printf("%d", Signal[Index]);
     }
     printf("\n");
-}
\ No newline at end of file
+}
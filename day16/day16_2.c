@@ -5,61 +5,250 @@
     ** 19 Dec 2019 Taipei **
 */
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
-#define SIGNAL_MAX (1<<24)
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define REPEAT 10000
+#define PHASES 100
+#define THREAD_COUNT 8
+#define BINOMIAL 1 // Jump straight to the last phase instead of running them all
+
+// Past the middle of the signal every pattern is zeros then ones, so a phase
+// is a suffix sum. The suffix is cut into chunks that are scanned on their
+// own threads, then each chunk adds the sum of the chunks after it.
+struct chunk
+{
+    uint8_t* Digits;
+    int Length;
+    uint8_t Carry; // Sum of everything after the chunk from the last phase
+    uint8_t Total; // Sum of the chunk after this phase
+};
+
+// Add the same digit to a run of digits, mod 10
+void
+AddCarry(uint8_t* Digits, int Length, uint8_t Carry)
+{
+    int Index = 0;
+#ifdef __AVX2__
+    __m256i Add = _mm256_set1_epi8(Carry);
+    __m256i Ten = _mm256_set1_epi8(10);
+    for(;
+        Index + 32 <= Length;
+        Index += 32)
+    {
+        __m256i Sum = _mm256_add_epi8(_mm256_loadu_si256((__m256i*)&Digits[Index]), Add);
+
+        // Sums under 10 wrap around to 246 and up when 10 is taken off, so
+        // the smaller of the two is the digit either way
+        Sum = _mm256_min_epu8(Sum, _mm256_sub_epi8(Sum, Ten));
+        _mm256_storeu_si256((__m256i*)&Digits[Index], Sum);
+    }
+#endif
+    for(;
+        Index < Length;
+        ++Index)
+    {
+        int Sum = Digits[Index] + Carry;
+        Digits[Index] = Sum >= 10 ? Sum - 10 : Sum;
+    }
+}
+
+// Finish the last phase on the chunk, then run this phase's suffix sum
+// within it
+int
+ScanChunk(void* Data)
+{
+    struct chunk* Chunk = Data;
+
+    if(Chunk->Carry)
+    {
+        AddCarry(Chunk->Digits, Chunk->Length, Chunk->Carry);
+    }
+
+    int Sum = 0;
+    for(int Index = Chunk->Length-1;
+        Index >= 0;
+        --Index)
+    {
+        Sum += Chunk->Digits[Index];
+        Sum -= Sum >= 10 ? 10 : 0;
+        Chunk->Digits[Index] = Sum;
+    }
+    Chunk->Total = Sum;
+
+    return 0;
+}
+
+// After P phases a digit is the sum of the digits from it to the end, the
+// one K places on weighted by C(K+P-1, P-1). Only the weights mod 10 matter,
+// which Lucas's theorem gives mod 2 and mod 5.
+
+// C(N, R) mod 10 for N >= R >= 0
+int
+BinomialMod10(long long N, long long R)
+{
+    // Mod 2 it's 1 exactly when R's bits are a subset of N's
+    int Mod2 = (N & R) == R;
+
+    // Mod 5 it's the product of the binomials of the base 5 digits
+    static const int Small[5][5] =
+    {
+        {1, 0, 0, 0, 0},
+        {1, 1, 0, 0, 0},
+        {1, 2, 1, 0, 0},
+        {1, 3, 3, 1, 0},
+        {1, 4, 1, 4, 1}, // 6 mod 5
+    };
+    int Mod5 = 1;
+    for(; R > 0 && Mod5; N /= 5, R /= 5)
+    {
+        Mod5 = Mod5 * Small[N % 5][R % 5] % 5;
+    }
+
+    // The one digit that is Mod2 mod 2 and Mod5 mod 5
+    return (5 * Mod2 + 6 * Mod5) % 10;
+}
 
 int
 main(void)
 {
-    int* Signal = malloc(sizeof(int) * SIGNAL_MAX);
-    int Count = 0;
+    int Capacity = 1024;
+    uint8_t* Input = malloc(Capacity);
+    int InputCount = 0;
 
     FILE* File = fopen("day16_input.txt", "r");
-    while(fscanf(File, "%1d", &Signal[Count]) != EOF)
+    int Char;
+    while((Char = fgetc(File)) != EOF)
+    {
+        if(Char >= '0' && Char <= '9')
+        {
+            if(InputCount == Capacity)
+            {
+                Capacity *= 2;
+                Input = realloc(Input, Capacity);
+            }
+            Input[InputCount++] = Char - '0';
+        }
+    }
+
+    int Offset = 0;
+    for(int Index = 0;
+        Index < 7;
+        ++Index)
     {
-        ++Count;
+        Offset = Offset * 10 + Input[Index];
     }
 
-    int Repeat = 10000;
-    for(int Index = 1;
-        Index < Repeat;
+    int Count = InputCount * REPEAT;
+    if(Offset < Count/2 || Offset + 8 > Count)
+    {
+        printf("Offset %d is not in the second half of the signal\n", Offset);
+        return 1;
+    }
+
+    // Nothing before the offset feeds the digits after it
+    int Length = Count - Offset;
+    uint8_t* Signal = malloc(Length);
+    for(int Index = 0;
+        Index < Length;
         ++Index)
     {
-        memcpy(&Signal[Count*Index], Signal, sizeof(int) * Count);
+        Signal[Index] = Input[(Offset + Index) % InputCount];
     }
-    Count *= Repeat;
 
-    int Offset = Signal[0] * 1000000
-               + Signal[1] * 100000
-               + Signal[2] * 10000
-               + Signal[3] * 1000
-               + Signal[4] * 100
-               + Signal[5] * 10
-               + Signal[6] * 1;
+#if BINOMIAL
+    // All the digits share the weights, one pass works them out and a pass
+    // per digit sums against them, whatever the phase count
+    uint8_t* Weights = malloc(Length);
+    for(int Index = 0;
+        Index < Length;
+        ++Index)
+    {
+        Weights[Index] = BinomialMod10(Index + PHASES - 1LL, PHASES - 1LL);
+    }
+
+    printf("Result: ");
+    for(int Digit = 0;
+        Digit < 8;
+        ++Digit)
+    {
+        long long Sum = 0;
+        for(int Index = Digit;
+            Index < Length;
+            ++Index)
+        {
+            Sum += Weights[Index - Digit] * Signal[Index];
+        }
+        printf("%d", (int)(Sum % 10));
+    }
+    printf("\n");
+#else
+    struct chunk Chunks[THREAD_COUNT] = {0};
+    for(int Index = 0;
+        Index < THREAD_COUNT;
+        ++Index)
+    {
+        int Start = (long long)Length * Index / THREAD_COUNT;
+        int End = (long long)Length * (Index + 1) / THREAD_COUNT;
+        Chunks[Index].Digits = &Signal[Start];
+        Chunks[Index].Length = End - Start;
+    }
 
     for(int Phase = 0;
-        Phase < 100;
+        Phase < PHASES;
         ++Phase)
     {
-        int Sum = 0;
-        for(int Index = Count-1;
-            Index >= Count/2;
+        thrd_t Threads[THREAD_COUNT];
+        for(int Index = 0;
+            Index < THREAD_COUNT;
+            ++Index)
+        {
+            if(thrd_create(&Threads[Index], ScanChunk, &Chunks[Index]) != thrd_success)
+            {
+                printf("Failed to start a worker\n");
+                return 1;
+            }
+        }
+        for(int Index = 0;
+            Index < THREAD_COUNT;
+            ++Index)
+        {
+            thrd_join(Threads[Index], NULL);
+        }
+
+        // Scan the chunk totals back to front, the next phase's workers add
+        // them on before they start
+        int Carry = 0;
+        for(int Index = THREAD_COUNT-1;
+            Index >= 0;
             --Index)
         {
-            Sum += Signal[Index];
-            Signal[Index] = abs(Sum % 10);
+            Chunks[Index].Carry = Carry;
+            Carry = (Carry + Chunks[Index].Total) % 10;
         }
     }
 
+    for(int Index = 0;
+        Index < THREAD_COUNT;
+        ++Index)
+    {
+        AddCarry(Chunks[Index].Digits, Chunks[Index].Length, Chunks[Index].Carry);
+    }
+
     printf("Result: ");
     for(int Index = 0;
         Index < 8;
         ++Index)
     {
-        printf("%d", Signal[(Index + Offset) % Count]);
+        printf("%d", Signal[Index]);
     }
     printf("\n");
-}
\ No newline at end of file
+#endif
+}
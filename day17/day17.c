@@ -6,10 +6,15 @@
 */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 // Computer
 
 #define MEMORY_SIZE (16 * 1024)
@@ -286,15 +291,124 @@ LoadMemory(const char* Path, icv Memory[])
     fclose(File);
 }
 
+// Camera
+//
+// Rows are packed into bitmasks as they stream in, one bit per scaffold
+// cell. Only three rows are kept, and once the row below a row is in its
+// intersections are whole words at a time: the cell, both sides, above
+// and below must all be scaffold.
+
+#define CAMERA_WIDTH 4096
+#define ROW_WORDS (CAMERA_WIDTH / 64)
+
+struct camera
+{
+    uint64_t Rows[3][ROW_WORDS]; // Above, current and the one coming in
+    char Text[3][CAMERA_WIDTH + 1];
+    int Words; // Widest row so far, in words
+    int X;
+    int Y; // Row coming in
+    long long Sum;
+};
+
+int
+CountTrailingZeros(uint64_t Word)
+{
+#ifdef _MSC_VER
+    unsigned long Index;
+    _BitScanForward64(&Index, Word);
+    return Index;
+#else
+    return __builtin_ctzll(Word);
+#endif
+}
+
+// Rows rotate through the buffers, the row Y lives in slot Y % 3
+uint64_t*
+CameraRow(struct camera* Camera, int Y)
+{
+    static uint64_t Empty[ROW_WORDS];
+    return Y < 0 ? Empty : Camera->Rows[Y % 3];
+}
+
+// Find the intersections on row Y, the rows above and below are in
+void
+CameraScanRow(struct camera* Camera, int Y)
+{
+    uint64_t* Up = CameraRow(Camera, Y - 1);
+    uint64_t* Row = CameraRow(Camera, Y);
+    uint64_t* Down = CameraRow(Camera, Y + 1);
+    char* Text = Camera->Text[Y % 3];
+
+    for(int Word = 0; Word < Camera->Words; ++Word)
+    {
+        // Neighbours across word edges come in from the next words over
+        uint64_t Left = Row[Word] << 1 | (Word > 0 ? Row[Word - 1] >> 63 : 0);
+        uint64_t Right = Row[Word] >> 1 | (Word + 1 < Camera->Words ? Row[Word + 1] << 63 : 0);
+        uint64_t Crossings = Row[Word] & Up[Word] & Down[Word] & Left & Right;
+
+        while(Crossings)
+        {
+            int X = Word * 64 + CountTrailingZeros(Crossings);
+            Crossings &= Crossings - 1;
+            Text[X] = 'O';
+            Camera->Sum += (long long)X * Y;
+        }
+    }
+    puts(Text);
+}
+
+void
+CameraPut(struct camera* Camera, char Char)
+{
+    if(Char == '\n')
+    {
+        // The picture ends with an empty line
+        if(Camera->X == 0)
+        {
+            return;
+        }
+
+        // The new row completes the one above it
+        Camera->Text[Camera->Y % 3][Camera->X] = 0;
+        Camera->Words = Camera->Words > (Camera->X + 63) / 64 ? Camera->Words : (Camera->X + 63) / 64;
+        if(Camera->Y > 0)
+        {
+            CameraScanRow(Camera, Camera->Y - 1);
+        }
+
+        ++Camera->Y;
+        Camera->X = 0;
+        memset(CameraRow(Camera, Camera->Y), 0, sizeof(uint64_t) * ROW_WORDS);
+        return;
+    }
+
+    if(Camera->X == CAMERA_WIDTH)
+    {
+        printf("Camera row too wide\n");
+        exit(1);
+    }
+    CameraRow(Camera, Camera->Y)[Camera->X / 64] |= (uint64_t)(Char == '#') << (Camera->X % 64);
+    Camera->Text[Camera->Y % 3][Camera->X++] = Char;
+}
+
+// The last row has nothing below it
+void
+CameraFinish(struct camera* Camera)
+{
+    if(Camera->Y > 0)
+    {
+        CameraScanRow(Camera, Camera->Y - 1);
+    }
+}
+
 int
 main(void)
 {
     struct computer Computer = {0};
     LoadMemory("day17_input.txt", Computer.Memory);
 
-    char Screen[1024][1024] = {{0}};
-    int Width = 0;
-    int Height = 0;
+    static struct camera Camera = {0};
 
     bool Done = false;
     while(!Done)
@@ -313,45 +427,12 @@ main(void)
             }
             case INT_OUT:
             {
-                char Char = Computer.Out;
-                if(Char == '\n')
-                {
-                    Width = 0;
-                    ++Height;
-                }
-                else
-                {
-                    Screen[Height][Width++] = Char;
-                }
+                CameraPut(&Camera, Computer.Out);
                 break;
             }
         }
     }
-    Width = strlen(Screen[0]);
+    CameraFinish(&Camera);
 
-    int Sum = 0;
-    for(int Y = 1;
-        Y < Height-1;
-        ++Y)
-    {
-        for(int X = 1;
-            X < Width-1;
-            ++X)
-        {
-            if(Screen[Y][X] == '#' && Screen[Y][X+1] == '#' && Screen[Y][X-1] == '#' && Screen[Y+1][X] == '#' && Screen[Y-1][X] == '#')
-            {
-                Screen[Y][X] = 'O';
-                Sum += X * Y;
-            }
-        }
-    }
-
-    for(int Y = 0;
-        Y < Height;
-        ++Y)
-    {
-        puts(Screen[Y]);
-    }
-
-    printf("Result: %d\n", Sum);
-}
\ No newline at end of file
+    printf("Result: %lld\n", Camera.Sum);
+}
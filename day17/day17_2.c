@@ -13,6 +13,8 @@
 // Computer
 
 #define MEMORY_SIZE (16 * 1024)
+#define OUTPUT_SIZE 4096
+#define CAMERA_SIZE (64 * 1024)
 
 typedef long long icv;
 
@@ -72,6 +74,15 @@ struct computer
     int Flags;
     icv In;
     icv Out;
+
+    // Batched I/O (optional), OP_IN reads from the input span until it is
+    // exhausted and OP_OUT appends to the output buffer until it is full
+    const icv* InBuffer;
+    int InLength;
+    int InHead;
+    icv* OutBuffer;
+    int OutCapacity;
+    int OutLength;
 };
 
 icv
@@ -198,7 +209,12 @@ Run(struct computer* Computer)
             }
             case OP_IN:
             {
-                if(Test(F_IN))
+                if(Computer->InHead < Computer->InLength)
+                {
+                    Store(Computer->InBuffer[Computer->InHead++]);
+                    Unset(F_IN);
+                }
+                else if(Test(F_IN))
                 {
                     Store(Computer->In);
                     Unset(F_IN);
@@ -214,6 +230,14 @@ Run(struct computer* Computer)
             case OP_OUT:
             {
                 Computer->Out = Load();
+                if(Computer->OutBuffer)
+                {
+                    Computer->OutBuffer[Computer->OutLength++] = Computer->Out;
+                    if(Computer->OutLength < Computer->OutCapacity)
+                    {
+                        break;
+                    }
+                }
                 return INT_OUT;
             }
             case OP_JT:
@@ -269,6 +293,22 @@ Run(struct computer* Computer)
     }
 }
 
+void
+SetInput(struct computer* Computer, const icv* Input, int Length)
+{
+    Computer->InBuffer = Input;
+    Computer->InLength = Length;
+    Computer->InHead = 0;
+}
+
+void
+SetOutput(struct computer* Computer, icv* Buffer, int Capacity)
+{
+    Computer->OutBuffer = Buffer;
+    Computer->OutCapacity = Capacity;
+    Computer->OutLength = 0;
+}
+
 void
 LoadMemory(const char* Path, icv Memory[])
 {
@@ -286,6 +326,283 @@ LoadMemory(const char* Path, icv Memory[])
     fclose(File);
 }
 
+// Scaffold
+
+#define FUNCTION_COUNT 3
+#define FUNCTION_LENGTH 20 // Characters, not counting the newline
+#define MAIN_CALLS ((FUNCTION_LENGTH + 1) / 2)
+
+// Camera picture as the robot sent it, rows are newline terminated
+struct scaffold
+{
+    const char* Cells;
+    int Width;
+    int Height;
+    int Stride;
+};
+
+// Turn, then walk forward. The very first move may go straight ahead.
+struct move
+{
+    char Turn; // 'L', 'R' or 0
+    int Steps;
+};
+
+// Main routine as calls into the functions, each function is a run of moves
+struct routine
+{
+    int Main[MAIN_CALLS];
+    int MainLength;
+    int Start[FUNCTION_COUNT];
+    int Length[FUNCTION_COUNT];
+    int FunctionCount;
+};
+
+struct compressor
+{
+    const struct move* Moves;
+    int Count;
+    int* Common; // [I * (Count + 1) + J] moves match starting at I and at J
+    struct routine Routine;
+};
+
+enum dir
+{
+    DIR_UP    = 0,
+    DIR_RIGHT = 1,
+    DIR_DOWN  = 2,
+    DIR_LEFT  = 3
+};
+
+int DX[] = {0, 1, 0, -1};
+int DY[] = {-1, 0, 1, 0};
+
+// The picture ends at the first empty line, the prompt comes after it
+struct scaffold
+ParseScaffold(const char* Camera, int Length)
+{
+    struct scaffold Scaffold = {.Cells = Camera};
+    while(Scaffold.Width < Length && Camera[Scaffold.Width] != '\n')
+    {
+        ++Scaffold.Width;
+    }
+    Scaffold.Stride = Scaffold.Width + 1;
+    while((Scaffold.Height + 1) * Scaffold.Stride <= Length &&
+          Camera[Scaffold.Height * Scaffold.Stride] != '\n')
+    {
+        ++Scaffold.Height;
+    }
+    return Scaffold;
+}
+
+char
+GetCell(const struct scaffold* Scaffold, int X, int Y)
+{
+    if(X < 0 || X >= Scaffold->Width || Y < 0 || Y >= Scaffold->Height)
+    {
+        return '.';
+    }
+    return Scaffold->Cells[Y * Scaffold->Stride + X];
+}
+
+bool
+IsScaffold(const struct scaffold* Scaffold, int X, int Y)
+{
+    return GetCell(Scaffold, X, Y) != '.';
+}
+
+// Follow the scaffold from the robot to its far end, going straight across
+// intersections. Returns the number of moves, 0 if there's no robot.
+int
+WalkScaffold(const struct scaffold* Scaffold, struct move Moves[], int MaxMoves)
+{
+    int X = -1, Y = -1;
+    enum dir Dir = DIR_UP;
+    for(int CellY = 0; CellY < Scaffold->Height; ++CellY)
+    {
+        for(int CellX = 0; CellX < Scaffold->Width; ++CellX)
+        {
+            const char* Robot = strchr("^>v<", GetCell(Scaffold, CellX, CellY));
+            if(Robot && *Robot)
+            {
+                X = CellX;
+                Y = CellY;
+                Dir = Robot - "^>v<";
+            }
+        }
+    }
+    if(X < 0)
+    {
+        return 0;
+    }
+
+    int Count = 0;
+    for(;;)
+    {
+        struct move Move = {0};
+        if(!IsScaffold(Scaffold, X + DX[Dir], Y + DY[Dir]))
+        {
+            enum dir Left = (Dir + 3) % 4;
+            enum dir Right = (Dir + 1) % 4;
+            if(IsScaffold(Scaffold, X + DX[Left], Y + DY[Left]))
+            {
+                Move.Turn = 'L';
+                Dir = Left;
+            }
+            else if(IsScaffold(Scaffold, X + DX[Right], Y + DY[Right]))
+            {
+                Move.Turn = 'R';
+                Dir = Right;
+            }
+            else
+            {
+                break;
+            }
+        }
+        while(IsScaffold(Scaffold, X + DX[Dir], Y + DY[Dir]))
+        {
+            X += DX[Dir];
+            Y += DY[Dir];
+            ++Move.Steps;
+        }
+
+        if(Count == MaxMoves)
+        {
+            printf("Scaffold too long\n");
+            exit(1);
+        }
+        Moves[Count++] = Move;
+    }
+    return Count;
+}
+
+// Characters the move takes in a function, without the separating comma
+int
+MoveLength(struct move Move)
+{
+    int Length = Move.Turn ? 2 : 0;
+    for(int Steps = Move.Steps; Steps > 0; Steps /= 10)
+    {
+        ++Length;
+    }
+    return Length;
+}
+
+// Cover the moves from Position on, either with a function that matches here
+// or by starting a new one. The match table makes every check O(1).
+bool
+CompressFrom(struct compressor* Compressor, int Position)
+{
+    struct routine* Routine = &Compressor->Routine;
+    int Stride = Compressor->Count + 1;
+
+    if(Position == Compressor->Count)
+    {
+        return true;
+    }
+    if(Routine->MainLength == MAIN_CALLS)
+    {
+        return false;
+    }
+
+    for(int Function = 0; Function < Routine->FunctionCount; ++Function)
+    {
+        if(Compressor->Common[Position * Stride + Routine->Start[Function]] >= Routine->Length[Function])
+        {
+            Routine->Main[Routine->MainLength++] = Function;
+            if(CompressFrom(Compressor, Position + Routine->Length[Function]))
+            {
+                return true;
+            }
+            --Routine->MainLength;
+        }
+    }
+
+    if(Routine->FunctionCount < FUNCTION_COUNT)
+    {
+        int Function = Routine->FunctionCount++;
+        Routine->Start[Function] = Position;
+        Routine->Main[Routine->MainLength++] = Function;
+
+        int Length = -1; // No comma before the first move
+        for(int Moves = 1; Position + Moves <= Compressor->Count; ++Moves)
+        {
+            Length += 1 + MoveLength(Compressor->Moves[Position + Moves - 1]);
+            if(Length > FUNCTION_LENGTH)
+            {
+                break;
+            }
+            Routine->Length[Function] = Moves;
+            if(CompressFrom(Compressor, Position + Moves))
+            {
+                return true;
+            }
+        }
+
+        --Routine->MainLength;
+        --Routine->FunctionCount;
+    }
+    return false;
+}
+
+bool
+Compress(const struct move Moves[], int Count, struct routine* Routine)
+{
+    struct compressor Compressor = {.Moves = Moves, .Count = Count};
+
+    // Walk backwards so each entry extends the one diagonally after it
+    int Stride = Count + 1;
+    Compressor.Common = calloc((size_t)Stride * Stride, sizeof(int));
+    for(int I = Count - 1; I >= 0; --I)
+    {
+        for(int J = Count - 1; J >= 0; --J)
+        {
+            if(Moves[I].Turn == Moves[J].Turn && Moves[I].Steps == Moves[J].Steps)
+            {
+                Compressor.Common[I * Stride + J] = 1 + Compressor.Common[(I + 1) * Stride + J + 1];
+            }
+        }
+    }
+
+    bool Found = CompressFrom(&Compressor, 0);
+    *Routine = Compressor.Routine;
+    free(Compressor.Common);
+    return Found;
+}
+
+// Main routine, the functions and the live feed answer, one per line
+int
+FormatRoutine(const struct move Moves[], const struct routine* Routine, char* Text)
+{
+    char* At = Text;
+    for(int Call = 0; Call < Routine->MainLength; ++Call)
+    {
+        At += sprintf(At, "%s%c", Call ? "," : "", 'A' + Routine->Main[Call]);
+    }
+    *At++ = '\n';
+
+    for(int Function = 0; Function < FUNCTION_COUNT; ++Function)
+    {
+        for(int Index = 0; Index < Routine->Length[Function]; ++Index)
+        {
+            struct move Move = Moves[Routine->Start[Function] + Index];
+            if(Index > 0)
+            {
+                *At++ = ',';
+            }
+            if(Move.Turn)
+            {
+                At += sprintf(At, "%c,", Move.Turn);
+            }
+            At += sprintf(At, "%d", Move.Steps);
+        }
+        *At++ = '\n';
+    }
+
+    At += sprintf(At, "n\n"); // Show live feed
+    return At - Text;
+}
+
 int
 main(void)
 {
@@ -294,18 +611,37 @@ main(void)
 
     Computer.Memory[0] = 2;
 
-    const char* Commands =
-        "A,A,B,C,B,C,B,C,C,A\n" // Main
-        "L,10,R,8,R,8\n" // A
-        "L,10,L,12,R,8,R,10\n" // B
-        "R,10,L,12,R,10\n" // C
-        "n\n"; // Show live feed
-    int CommandsLength = strlen(Commands);
-    int CommandsIndex = 0;
+    // The robot shows the scaffold before asking for the routine
+    char* Camera = malloc(CAMERA_SIZE);
+    int CameraLength = 0;
+
+    char Commands[256];
+    int CommandsLength = 0;
+    icv Input[256];
+
+    icv Output[OUTPUT_SIZE];
 
     for(;;)
     {
+        SetOutput(&Computer, Output, OUTPUT_SIZE);
         enum interrupt Interrupt = Run(&Computer);
+
+        for(int I = 0; I < Computer.OutLength; ++I)
+        {
+            if(Output[I] < 128)
+            {
+                putchar(Output[I]);
+                if(!CommandsLength && CameraLength < CAMERA_SIZE)
+                {
+                    Camera[CameraLength++] = Output[I];
+                }
+            }
+            else
+            {
+                printf("%lld\n", Output[I]);
+            }
+        }
+
         switch(Interrupt)
         {
             case INT_HLT:
@@ -315,25 +651,44 @@ main(void)
             }
             case INT_IN:
             {
-                char Char = Commands[CommandsIndex++];
-                CommandsIndex %= CommandsLength;
-                putchar(Char);
-                Computer.In = Char;
-                break;
-            }
-            case INT_OUT:
-            {
-                int Char = Computer.Out;
-                if(Char < 128)
+                if(CommandsLength)
                 {
-                    putchar(Char);
+                    // The script went in whole, the robot rejected it or
+                    // read past its end
+                    printf("The robot wants more than the script\n");
+                    return 1;
                 }
-                else
+
+                struct scaffold Scaffold = ParseScaffold(Camera, CameraLength);
+                struct move Moves[256];
+                int MoveCount = WalkScaffold(&Scaffold, Moves, 256);
+
+                // The scaffold points into the camera, done with both
+                struct routine Routine;
+                bool Found = Compress(Moves, MoveCount, &Routine);
+                free(Camera);
+                Camera = NULL;
+                if(!Found)
                 {
-                    printf("%lld\n", Computer.Out);
+                    printf("No routine fits\n");
+                    return 1;
                 }
+                CommandsLength = FormatRoutine(Moves, &Routine, Commands);
+                for(int I = 0; I < CommandsLength; ++I)
+                {
+                    Input[I] = Commands[I];
+                }
+
+                // Feed the whole script once
+                fputs(Commands, stdout);
+                SetInput(&Computer, Input, CommandsLength);
+                break;
+            }
+            case INT_OUT:
+            {
+                // Output buffer full, keep going
                 break;
             }
         }
     }
-}
\ No newline at end of file
+}
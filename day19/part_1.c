@@ -7,10 +7,28 @@
  **/
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+
+#ifndef MAP_WIDTH
+#define MAP_WIDTH 50
+#endif
+
+#ifndef MAP_HEIGHT
+#define MAP_HEIGHT 50
+#endif
+
+#define THREAD_COUNT 8
+#define TILE_ROWS 64
+
+// Rows up to this one are scanned whole (the beam has gaps near the emitter)
+// and the last one gives the slopes of the beam edges
+#define CALIBRATION_ROW 50
 
 // Computer
 
@@ -291,7 +309,8 @@ int CheckTractorBeam(icv Program[MEMORY_SIZE], int X, int Y)
     struct computer Computer = {0};
     memcpy(Computer.Memory, Program, sizeof(icv) * MEMORY_SIZE);
 
-    int Inputs[] = {X, Y};
+    // Inputs are passed last to first
+    int Inputs[] = {Y, X};
     int InputsLength = 2;
 
     int Output = -1;
@@ -321,28 +340,270 @@ int CheckTractorBeam(icv Program[MEMORY_SIZE], int X, int Y)
     return Output;
 }
 
+// Beam Mapper
+
+// Beam cross-section on one row (inclusive, empty if Left > Right)
+struct beam_row
+{
+    int Left;
+    int Right;
+};
+
+// Packed 1-bit map of the points affected by the beam
+struct beam_map
+{
+    uint64_t *Bits;
+    int Width;
+    int Height;
+    int Stride; // Words per row
+};
+
+// Shared state of the mapper threads
+struct mapper
+{
+    icv *Program;
+    struct beam_map *Map;
+    struct beam_row Calibration;
+    atomic_int NextTile;
+    atomic_llong Count;
+};
+
+bool InBeam(icv Program[MEMORY_SIZE], int X, int Y)
+{
+    return X >= 0 && Y >= 0 && CheckTractorBeam(Program, X, Y);
+}
+
+bool GetBeamMap(struct beam_map *Map, int X, int Y)
+{
+    return (Map->Bits[Y * Map->Stride + X / 64] >> (X % 64)) & 1;
+}
+
+// Set the bits Left..Right of a row, rows never share words
+void FillBeamMapRow(struct beam_map *Map, int Y, int Left, int Right)
+{
+    uint64_t *Row = Map->Bits + (size_t)Y * Map->Stride;
+    for (int X = Left; X <= Right;)
+    {
+        int Bit = X % 64;
+        int Span = 64 - Bit;
+        if (Span > Right - X + 1)
+        {
+            Span = Right - X + 1;
+        }
+        uint64_t Mask = Span == 64 ? ~0ull : ((1ull << Span) - 1) << Bit;
+        Row[X / 64] |= Mask;
+        X += Span;
+    }
+}
+
+// Walk a row from the left, slow but makes no assumptions about the beam
+struct beam_row ScanBeamRow(icv Program[MEMORY_SIZE], int Y, int XMax)
+{
+    struct beam_row Row = {.Left = 1, .Right = 0};
+
+    int X = 0;
+    while (X <= XMax && !InBeam(Program, X, Y))
+    {
+        ++X;
+    }
+    if (X > XMax)
+    {
+        return Row;
+    }
+    Row.Left = X;
+    while (X < XMax && InBeam(Program, X + 1, Y))
+    {
+        ++X;
+    }
+    Row.Right = X;
+    return Row;
+}
+
+// Find the last X in direction Step (+1 or -1) still inside the beam,
+// starting from a point inside the beam
+int GallopBeamEdge(icv Program[MEMORY_SIZE], int X, int Y, int Step)
+{
+    int In = X;
+    int Out = X + Step;
+    int Stride = 1;
+    while (InBeam(Program, Out, Y))
+    {
+        In = Out;
+        Stride *= 2;
+        Out = In + Step * Stride;
+    }
+    while (abs(Out - In) > 1)
+    {
+        int Mid = In + (Out - In) / 2;
+        if (InBeam(Program, Mid, Y))
+        {
+            In = Mid;
+        }
+        else
+        {
+            Out = Mid;
+        }
+    }
+    return In;
+}
+
+// Find the beam on a row with no previous row to start from
+struct beam_row FindBeamRow(struct mapper *Mapper, int Y)
+{
+    if (Y <= CALIBRATION_ROW)
+    {
+        return ScanBeamRow(Mapper->Program, Y, 10 * (Y + 1));
+    }
+
+    long long Left = (long long)Mapper->Calibration.Left * Y / CALIBRATION_ROW;
+    long long Right = (long long)Mapper->Calibration.Right * Y / CALIBRATION_ROW;
+    int Center = (Left + Right) / 2;
+
+    for (int Offset = 0; Offset <= (Right - Left) / 2 + 1; ++Offset)
+    {
+        int X = InBeam(Mapper->Program, Center + Offset, Y)   ? Center + Offset
+                : InBeam(Mapper->Program, Center - Offset, Y) ? Center - Offset
+                                                              : -1;
+        if (X >= 0)
+        {
+            return (struct beam_row){
+                .Left = GallopBeamEdge(Mapper->Program, X, Y, -1),
+                .Right = GallopBeamEdge(Mapper->Program, X, Y, +1),
+            };
+        }
+    }
+    return ScanBeamRow(Mapper->Program, Y, 10 * (Y + 1));
+}
+
+// Find the beam on a row from the beam on the previous row, both edges only
+// ever move right so this is a few probes per row
+struct beam_row TrackBeamRow(struct mapper *Mapper, int Y, struct beam_row Previous)
+{
+    icv *Program = Mapper->Program;
+    if (Y <= CALIBRATION_ROW || Previous.Left > Previous.Right)
+    {
+        return FindBeamRow(Mapper, Y);
+    }
+
+    int Left = Previous.Left;
+    while (Left <= Previous.Right + 1 && !InBeam(Program, Left, Y))
+    {
+        ++Left;
+    }
+    if (Left > Previous.Right + 1)
+    {
+        // The beam jumped further than one column, start over
+        return FindBeamRow(Mapper, Y);
+    }
+    while (InBeam(Program, Left - 1, Y))
+    {
+        --Left;
+    }
+
+    int Right = Previous.Right > Left ? Previous.Right : Left;
+    while (Right > Left && !InBeam(Program, Right, Y))
+    {
+        --Right;
+    }
+    while (InBeam(Program, Right + 1, Y))
+    {
+        ++Right;
+    }
+
+    return (struct beam_row){.Left = Left, .Right = Right};
+}
+
+// Map tiles of rows until there are none left
+int MapBeamTiles(void *Data)
+{
+    struct mapper *Mapper = Data;
+    struct beam_map *Map = Mapper->Map;
+
+    for (;;)
+    {
+        int Tile = atomic_fetch_add(&Mapper->NextTile, 1);
+        int Top = Tile * TILE_ROWS;
+        if (Top >= Map->Height)
+        {
+            return 0;
+        }
+        int Bottom = Top + TILE_ROWS < Map->Height ? Top + TILE_ROWS : Map->Height;
+
+        long long Count = 0;
+        struct beam_row Row = {.Left = 1, .Right = 0};
+        for (int Y = Top; Y < Bottom; ++Y)
+        {
+            Row = TrackBeamRow(Mapper, Y, Row);
+
+            // Clip to the map, everything outside the edges is empty
+            int Left = Row.Left;
+            int Right = Row.Right < Map->Width - 1 ? Row.Right : Map->Width - 1;
+            if (Left <= Right)
+            {
+                FillBeamMapRow(Map, Y, Left, Right);
+                Count += Right - Left + 1;
+            }
+        }
+        atomic_fetch_add(&Mapper->Count, Count);
+    }
+}
+
+// Map the beam over Width x Height points, returns the number of affected points
+long long MapBeam(icv Program[MEMORY_SIZE], struct beam_map *Map, int Width, int Height)
+{
+    int Stride = (Width + 63) / 64;
+    uint64_t *Bits = calloc((size_t)Stride * Height, sizeof(uint64_t));
+    assert(Bits && "Beam map alloc failed!");
+
+    *Map = (struct beam_map){.Bits = Bits, .Width = Width, .Height = Height, .Stride = Stride};
+
+    struct mapper Mapper = {
+        .Program = Program,
+        .Map = Map,
+        .Calibration = ScanBeamRow(Program, CALIBRATION_ROW, 10 * (CALIBRATION_ROW + 1)),
+    };
+    assert(Mapper.Calibration.Left <= Mapper.Calibration.Right);
+    atomic_init(&Mapper.NextTile, 0);
+    atomic_init(&Mapper.Count, 0);
+
+    thrd_t Threads[THREAD_COUNT];
+    for (int i = 0; i < THREAD_COUNT; ++i)
+    {
+        if (thrd_create(&Threads[i], MapBeamTiles, &Mapper) != thrd_success)
+        {
+            puts("Failed to start a mapper thread");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < THREAD_COUNT; ++i)
+    {
+        thrd_join(Threads[i], NULL);
+    }
+
+    return atomic_load(&Mapper.Count);
+}
+
 int main(void)
 {
     icv Program[MEMORY_SIZE] = {0};
     LoadMemory("input.txt", Program);
 
-    int PulledCount = 0;
-    for (int Y = 0; Y < 50; ++Y)
+    struct beam_map Map;
+    long long PulledCount = MapBeam(Program, &Map, MAP_WIDTH, MAP_HEIGHT);
+
+    if (MAP_WIDTH <= 100 && MAP_HEIGHT <= 100)
     {
-        for (int X = 0; X < 50; ++X)
+        for (int Y = 0; Y < MAP_HEIGHT; ++Y)
         {
-            if (CheckTractorBeam(Program, X, Y))
-            {
-                ++PulledCount;
-                putchar('#');
-            }
-            else
+            for (int X = 0; X < MAP_WIDTH; ++X)
             {
-                putchar('.');
+                putchar(GetBeamMap(&Map, X, Y) ? '#' : '.');
             }
+            putchar('\n');
         }
-        putchar('\n');
     }
 
-    printf("Tractor beam is affecting %d points\n", PulledCount);
+    free(Map.Bits);
+
+    printf("Tractor beam is affecting %lld points\n", PulledCount);
 }
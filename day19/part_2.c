@@ -8,16 +8,35 @@
 
 #define INTCODE_IMPL
 
+#include "intcode.h"
 #include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "intcode.h"
 
 #define EXAMPLE 0
+#define MEMOIZE 1
+#define GALLOP 1 // Binary search over rows instead of walking them
+
+#ifndef SHIP_SIZE
+#define SHIP_SIZE 100
+#endif
+
+// Row on which the beam slopes are measured, or the last row the beam
+// reaches if it ends sooner
+#define CALIBRATION_ROW 50
+
+// Drone program and the results of its probes
+typedef struct
+{
+    icv Program[MEMORY_SIZE];
+    uint64_t Hash; // HashProgram of Program, redo it if Program changes
+    memo Memo;
+} drone;
 
-int CheckTractorBeam(icv Program[MEMORY_SIZE], int X, int Y)
+int CheckTractorBeam(drone *Drone, int X, int Y)
 {
 #if EXAMPLE
     char ExampleBeam[40][40] = {
@@ -67,63 +86,252 @@ int CheckTractorBeam(icv Program[MEMORY_SIZE], int X, int Y)
         return 0;
     }
 #else
-    computer Computer = {0};
-    memcpy(Computer.Memory, Program, sizeof(icv) * MEMORY_SIZE);
+    // Inputs are read X first, then Y
+    icv Inputs[] = {X, Y};
+    assert(X >= 0 && Y >= 0);
+
+#if MEMOIZE
+    // Most coordinates are probed more than once
+    return RunMemo(&Drone->Memo, Drone->Program, Drone->Hash, Inputs, 2);
+#else
+    return RunPure(Drone->Program, Inputs, 2);
+#endif
+#endif
+}
+
+// Beam cross-section on row Y (inclusive, empty if Left > Right)
+typedef struct
+{
+    int Y;
+    int Left;
+    int Right;
+} beam_row;
+
+bool InBeam(drone *Drone, int X, int Y)
+{
+    return X >= 0 && Y >= 0 && CheckTractorBeam(Drone, X, Y);
+}
+
+// Walk a row from the left, slow but makes no assumptions about the beam
+beam_row ScanBeamRow(drone *Drone, int Y)
+{
+    beam_row Row = {.Y = Y, .Left = 1, .Right = 0};
+
+    // The beam never gets wider than this many columns per row
+    int XMax = 10 * (Y + 1);
+
+    int X = 0;
+    while (X <= XMax && !InBeam(Drone, X, Y))
+    {
+        ++X;
+    }
+    if (X > XMax)
+    {
+        return Row;
+    }
+    Row.Left = X;
+    while (InBeam(Drone, X + 1, Y))
+    {
+        ++X;
+    }
+    Row.Right = X;
+    return Row;
+}
 
-    // Inputs are passed last to first
-    int Inputs[] = {Y, X};
-    int InputsLength = 2;
+// Find the last X in direction Step (+1 or -1) still inside the beam,
+// starting from a point inside the beam
+int GallopBeamEdge(drone *Drone, int X, int Y, int Step)
+{
+    assert(InBeam(Drone, X, Y));
 
-    int Output = -1;
+    // Double the stride until we leave the beam
+    int In = X;
+    int Out = X + Step;
+    int Stride = 1;
+    while (InBeam(Drone, Out, Y))
+    {
+        In = Out;
+        Stride *= 2;
+        Out = In + Step * Stride;
+    }
 
-    bool Done = false;
-    while (!Done)
+    // Bisect between the last point in and the first point out
+    while (abs(Out - In) > 1)
     {
-        interrupt Interrupt = Run(&Computer);
-        switch (Interrupt)
+        int Mid = In + (Out - In) / 2;
+        if (InBeam(Drone, Mid, Y))
         {
-        case INT_HLT:
-            Done = true;
-            break;
-        case INT_IN:
-            assert(InputsLength > 0);
-            assert(Inputs[InputsLength - 1] >= 0);
-            Computer.In = Inputs[--InputsLength];
-            break;
-        case INT_OUT:
-            Output = Computer.Out;
-            break;
-        default:
-            printf("Bad interrupt: %d\n", Interrupt);
-            exit(1);
+            In = Mid;
+        }
+        else
+        {
+            Out = Mid;
         }
     }
+    return In;
+}
 
-    return Output;
-#endif
+// Find the beam edges on row Y using the edge slopes of the calibration row
+beam_row FindBeamRow(drone *Drone, beam_row Calibration, int Y)
+{
+    if (Y <= Calibration.Y)
+    {
+        return ScanBeamRow(Drone, Y);
+    }
+
+    long long Left = (long long)Calibration.Left * Y / Calibration.Y;
+    long long Right = (long long)Calibration.Right * Y / Calibration.Y;
+    int Center = (Left + Right) / 2;
+
+    // Rounding can leave the estimate just outside a thin beam
+    int X = -1;
+    for (int Offset = 0; Offset <= (Right - Left) / 2 + 1 && X < 0; ++Offset)
+    {
+        if (InBeam(Drone, Center + Offset, Y))
+        {
+            X = Center + Offset;
+        }
+        else if (InBeam(Drone, Center - Offset, Y))
+        {
+            X = Center - Offset;
+        }
+    }
+    if (X < 0)
+    {
+        return ScanBeamRow(Drone, Y);
+    }
+
+    return (beam_row){
+        .Y = Y,
+        .Left = GallopBeamEdge(Drone, X, Y, -1),
+        .Right = GallopBeamEdge(Drone, X, Y, +1),
+    };
 }
 
-int main(void)
+// Does a ship fit with its bottom-left corner on the left edge of row Y?
+bool ShipFits(drone *Drone, beam_row Calibration, int ShipSize, int Y, int *X)
+{
+    if (Y - (ShipSize - 1) < 0)
+    {
+        return false;
+    }
+
+    beam_row Bottom = FindBeamRow(Drone, Calibration, Y);
+    beam_row Top = FindBeamRow(Drone, Calibration, Y - (ShipSize - 1));
+    if (Bottom.Left > Bottom.Right || Top.Left > Top.Right)
+    {
+        return false;
+    }
+
+    *X = Bottom.Left;
+    return Bottom.Left + (ShipSize - 1) <= Top.Right;
+}
+
+// Measure the edge slopes on the calibration row. Stepping back from it
+// only happens on a map that ends sooner, such as the example.
+beam_row Calibrate(drone *Drone)
+{
+    for (int Y = CALIBRATION_ROW; Y > 0; --Y)
+    {
+        beam_row Row = ScanBeamRow(Drone, Y);
+        if (Row.Left <= Row.Right)
+        {
+            return Row;
+        }
+    }
+    printf("No beam to calibrate on\n");
+    exit(1);
+}
+
+// Find the top-left corner of the closest square that fits the ship in
+// O(log Y) rows, each costing O(log X) probes
+void FindShipGallop(drone *Drone, int ShipSize, int *ShipX, int *ShipY)
 {
-    icv Program[MEMORY_SIZE] = {0};
-    LoadMemory("input.txt", Program);
+    beam_row Calibration = Calibrate(Drone);
+
+    // A beam that ends before the calibration row ends there
+    int LastRow = Calibration.Y < CALIBRATION_ROW ? Calibration.Y : INT_MAX / 2;
+
+    // Gallop until the ship fits
+    int X;
+    int Lo = ShipSize - 1;
+    int Hi = ShipSize;
+    while (!ShipFits(Drone, Calibration, ShipSize, Hi, &X))
+    {
+        if (Hi >= LastRow)
+        {
+            printf("The ship doesn't fit in the beam\n");
+            exit(1);
+        }
+        Lo = Hi;
+        Hi = Hi < LastRow / 2 ? Hi * 2 : LastRow;
+    }
+
+    // Bisect, the ship fits on Hi but not on Lo
+    while (Hi - Lo > 1)
+    {
+        int Mid = Lo + (Hi - Lo) / 2;
+        if (ShipFits(Drone, Calibration, ShipSize, Mid, &X))
+        {
+            Hi = Mid;
+        }
+        else
+        {
+            Lo = Mid;
+        }
+    }
+
+    /**
+     * The bisection trusts that the ship keeps fitting further down, which
+     * only holds up to rounding. The beam edges are lines through the emitter
+     * rounded to whole columns, so the slack
+     *
+     *     Top.Right - Bottom.Left - (ShipSize - 1)
+     *
+     * lies less than 2 columns below a line rising by the beam's widening
+     * per row, which is at least Width / Calibration.Y. The ship doesn't fit
+     * on Lo, so the line is below 1 there, and it is below 0 more than
+     * Calibration.Y / Width rows further up, where the ship can't fit. Only
+     * the rows in between have to be checked.
+     **/
+    int Width = Calibration.Right - Calibration.Left;
+    int First = ShipSize - 1;
+    if (Width > 0)
+    {
+        int Window = (Calibration.Y + Width - 1) / Width;
+        First = Lo - Window + 1 > First ? Lo - Window + 1 : First;
+    }
+    for (int Y = First; Y <= Lo; ++Y)
+    {
+        if (ShipFits(Drone, Calibration, ShipSize, Y, &X))
+        {
+            Hi = Y;
+            break;
+        }
+    }
 
-    int ShipSize = 100;
+    ShipFits(Drone, Calibration, ShipSize, Hi, &X);
+    *ShipX = X;
+    *ShipY = Hi - (ShipSize - 1);
+}
 
+// Walk the left edge of the beam one row at a time
+void FindShipWalk(drone *Drone, int ShipSize, int *ShipX, int *ShipY)
+{
     int X = 0;
     int Y = ShipSize;
 
     // Catch the beam
-    while (!CheckTractorBeam(Program, X, Y))
+    while (!CheckTractorBeam(Drone, X, Y))
     {
         ++X;
     }
 
     // Find the square that fits the ship
-    while (!CheckTractorBeam(Program, X + (ShipSize - 1), Y - (ShipSize - 1)))
+    while (!CheckTractorBeam(Drone, X + (ShipSize - 1), Y - (ShipSize - 1)))
     {
         ++Y;
-        while (!CheckTractorBeam(Program, X, Y))
+        while (!CheckTractorBeam(Drone, X, Y))
         {
             ++X;
         }
@@ -132,36 +340,63 @@ int main(void)
     }
 
     // Top-left corner of the square
-    Y -= (ShipSize - 1);
+    *ShipX = X;
+    *ShipY = Y - (ShipSize - 1);
+}
+
+int main(void)
+{
+    drone *Drone = calloc(1, sizeof(drone));
+    assert(Drone);
+    LoadMemoryImage("input.txt", Drone->Program);
+    Drone->Hash = HashProgram(Drone->Program);
+#if MEMOIZE
+    Drone->Memo = MemoCreate(16 * 1024);
+#endif
+
+    int ShipSize = SHIP_SIZE;
+
+    int X, Y;
+#if GALLOP
+    FindShipGallop(Drone, ShipSize, &X, &Y);
+#else
+    FindShipWalk(Drone, ShipSize, &X, &Y);
+#endif
 
-    // Print
-    for (int y = Y - 5; y < Y + ShipSize + 5; ++y)
+    // Print (only small ships, every point is a VM run)
+    if (ShipSize <= 100)
     {
-        for (int x = X - 5; x < X + ShipSize + 5; ++x)
+        for (int y = Y - 5; y < Y + ShipSize + 5; ++y)
         {
-            if (CheckTractorBeam(Program, x, y))
+            for (int x = X - 5; x < X + ShipSize + 5; ++x)
             {
-                if (x == X && y == Y)
-                {
-                    putchar('X');
-                }
-                else if (x >= X && x < X + ShipSize &&
-                         y >= Y && y < Y + ShipSize)
+                if (InBeam(Drone, x, y))
                 {
-                    putchar('O');
+                    if (x == X && y == Y)
+                    {
+                        putchar('X');
+                    }
+                    else if (x >= X && x < X + ShipSize &&
+                             y >= Y && y < Y + ShipSize)
+                    {
+                        putchar('O');
+                    }
+                    else
+                    {
+                        putchar('#');
+                    }
                 }
                 else
                 {
-                    putchar('#');
+                    putchar('.');
                 }
             }
-            else
-            {
-                putchar('.');
-            }
+            putchar('\n');
         }
-        putchar('\n');
     }
 
-    printf("Output: %d (%d,%d)\n", X * 10000 + Y, X, Y);
+    printf("Output: %lld (%d,%d)\n", X * 10000LL + Y, X, Y);
+
+    MemoDestroy(&Drone->Memo);
+    free(Drone);
 }
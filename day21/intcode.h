@@ -1,10 +1,24 @@
 #ifndef __INTCODE_H__
 #define __INTCODE_H__
 
+// Needed for fstat and mmap under -std=c11, before any system header
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #define MEMORY_SIZE (16 * 1024)
 
@@ -75,10 +89,82 @@ typedef struct
     iop Op;    // Last operation (useful during interrupts)
     icv In;
     icv Out;
+
+    // Batched I/O (optional), see SetInput and SetOutput
+    const icv *InBuffer;
+    icv InLength;
+    icv InHead;
+    icv *OutBuffer;
+    icv OutCapacity;
+    icv OutLength;
 } computer;
 
 icv LoadMemory(const char *Filename, icv Memory[MEMORY_SIZE]);
 interrupt Run(computer *Computer);
+void SetInput(computer *Computer, const icv *Input, icv Length);
+void SetOutput(computer *Computer, icv *Buffer, icv Capacity);
+
+//
+// Program images
+//
+
+/**
+ * A program image is a pre-parsed program that can be mapped read-only and
+ * shared by every process running the same program. All fields are
+ * little-endian.
+ *
+ *     image_header Header;
+ *     int64_t      Words[Header.Length];
+ *     imeta        Meta[Header.Length];  // Only if IMAGE_DECODED is set
+ *
+ * The mapping is never written, a program is copied into a computer's memory
+ * when it runs.
+ **/
+
+#define IMAGE_MAGIC 0x4d494349 // "ICIM"
+#define IMAGE_VERSION 1
+#define IMAGE_SUFFIX ".img"
+
+// Image flags
+typedef enum
+{
+    IMAGE_DECODED = 1, // Instruction metadata follows the words
+} image_flag;
+
+typedef struct
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Length;     // Program length in words
+    uint64_t SourceHash; // FNV-1a hash of the source text
+    uint64_t Flags;
+} image_header;
+
+// Pre-decoded instruction metadata (one per word)
+typedef struct
+{
+    uint8_t Opcode; // 0 if the word is not a valid operation
+    uint8_t Pmodes; // 2 bits per parameter, first parameter in the low bits
+} imeta;
+
+// Mapped image
+typedef struct
+{
+    image_header Header; // Host byte order
+    const int64_t *Words;
+    const imeta *Meta; // NULL if the image is not decoded
+    void *Base;
+    size_t Size;
+    bool Owned; // Heap copy instead of a mapping
+} image;
+
+uint64_t HashSource(const char *Text, size_t Length);
+bool ConvertImage(const char *SourcePath, const char *ImagePath, bool Decode);
+bool MapImage(const char *Path, image *Image);
+void UnmapImage(image *Image);
+void OpenImage(const char *Filename, image *Image);
+icv LoadImage(const image *Image, icv Memory[MEMORY_SIZE]);
+icv LoadMemoryImage(const char *Filename, icv Memory[MEMORY_SIZE]);
 
 // Implementation
 
@@ -102,6 +188,389 @@ icv LoadMemory(const char *Filename, icv Memory[MEMORY_SIZE])
     return Size;
 }
 
+//
+// Program images
+//
+
+bool IsLittleEndian(void)
+{
+    uint16_t Probe = 1;
+    return *(uint8_t *)&Probe == 1;
+}
+
+uint64_t FromLE64(uint64_t Value)
+{
+    if (IsLittleEndian())
+    {
+        return Value;
+    }
+    uint64_t Result = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        Result = (Result << 8) | ((Value >> (i * 8)) & 0xff);
+    }
+    return Result;
+}
+
+uint32_t FromLE32(uint32_t Value)
+{
+    if (IsLittleEndian())
+    {
+        return Value;
+    }
+    return (Value >> 24) | ((Value >> 8) & 0xff00) | ((Value << 8) & 0xff0000) | (Value << 24);
+}
+
+// The conversion is its own inverse
+#define ToLE64 FromLE64
+#define ToLE32 FromLE32
+
+// FNV-1a
+uint64_t HashSource(const char *Text, size_t Length)
+{
+    uint64_t Hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < Length; ++i)
+    {
+        Hash ^= (uint8_t)Text[i];
+        Hash *= 0x100000001b3;
+    }
+    return Hash;
+}
+
+// Read a whole file, the caller frees the result
+char *ReadSource(const char *Path, size_t *Length)
+{
+    FILE *File = fopen(Path, "rb");
+    if (!File)
+    {
+        return NULL;
+    }
+    fseek(File, 0, SEEK_END);
+    long Size = ftell(File);
+    fseek(File, 0, SEEK_SET);
+    if (Size < 0)
+    {
+        fclose(File);
+        return NULL;
+    }
+
+    char *Text = malloc(Size + 1);
+    assert(Text);
+
+    *Length = fread(Text, 1, Size, File);
+    Text[*Length] = '\0';
+    fclose(File);
+    return Text;
+}
+
+// Decode a word as if it was an operation
+imeta DecodeOp(int64_t Word)
+{
+    imeta Meta = {0};
+    if (Word <= 0 || Word >= 100000)
+    {
+        return Meta;
+    }
+
+    int64_t Opcode = Word % 100;
+    if (Opcode < 1 || (Opcode > OP_ARB && Opcode != OP_HLT))
+    {
+        return Meta;
+    }
+
+    int64_t Pmodes = Word / 100;
+    for (int i = 0; i < 3; ++i, Pmodes /= 10)
+    {
+        int64_t Mode = Pmodes % 10;
+        if (Mode > PMODE_REL)
+        {
+            return Meta;
+        }
+        Meta.Pmodes |= Mode << (i * 2);
+    }
+    Meta.Opcode = Opcode;
+    return Meta;
+}
+
+// Lay out the image of a source text in memory, the caller frees it
+void *BuildImage(const char *Text, size_t Length, bool Decode, size_t *Size)
+{
+    size_t Capacity = 1024;
+    size_t Count = 0;
+    int64_t *Words = malloc(sizeof(int64_t) * Capacity);
+    assert(Words);
+
+    const char *Cursor = Text;
+    for (;;)
+    {
+        char *End;
+        int64_t Word = strtoll(Cursor, &End, 10);
+        if (End == Cursor)
+        {
+            break;
+        }
+        if (Count == Capacity)
+        {
+            Capacity *= 2;
+            Words = realloc(Words, sizeof(int64_t) * Capacity);
+            assert(Words);
+        }
+        Words[Count++] = Word;
+        Cursor = End;
+        while (*Cursor == ',' || *Cursor == ' ' || *Cursor == '\r' || *Cursor == '\n')
+        {
+            ++Cursor;
+        }
+    }
+
+    *Size = sizeof(image_header) + sizeof(int64_t) * Count;
+    if (Decode)
+    {
+        *Size += sizeof(imeta) * Count;
+    }
+    uint8_t *Base = malloc(*Size);
+    assert(Base);
+
+    image_header *Header = (image_header *)Base;
+    *Header = (image_header){
+        .Magic = ToLE32(IMAGE_MAGIC),
+        .Version = ToLE32(IMAGE_VERSION),
+        .Length = ToLE64(Count),
+        .SourceHash = ToLE64(HashSource(Text, Length)),
+        .Flags = ToLE64(Decode ? IMAGE_DECODED : 0),
+    };
+
+    int64_t *ImageWords = (int64_t *)(Header + 1);
+    for (size_t i = 0; i < Count; ++i)
+    {
+        ImageWords[i] = ToLE64(Words[i]);
+    }
+    if (Decode)
+    {
+        imeta *Meta = (imeta *)(ImageWords + Count);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            Meta[i] = DecodeOp(Words[i]);
+        }
+    }
+
+    free(Words);
+    return Base;
+}
+
+bool ConvertImage(const char *SourcePath, const char *ImagePath, bool Decode)
+{
+    size_t Length;
+    char *Text = ReadSource(SourcePath, &Length);
+    if (!Text)
+    {
+        return false;
+    }
+
+    size_t Size;
+    void *Base = BuildImage(Text, Length, Decode, &Size);
+    free(Text);
+
+    // Written next to the image and renamed over it, processes that still
+    // have the old image mapped keep the old file instead of seeing it
+    // truncated under them
+    char TempPath[1024];
+    snprintf(TempPath, sizeof(TempPath), "%s.tmp", ImagePath);
+
+    FILE *File = fopen(TempPath, "wb");
+    if (!File)
+    {
+        free(Base);
+        return false;
+    }
+    bool Ok = fwrite(Base, Size, 1, File) == 1;
+    Ok = fclose(File) == 0 && Ok;
+    free(Base);
+
+#ifdef _WIN32
+    // rename doesn't replace files here
+    remove(ImagePath);
+#endif
+    Ok = Ok && rename(TempPath, ImagePath) == 0;
+    if (!Ok)
+    {
+        remove(TempPath);
+    }
+    return Ok;
+}
+
+// Check an image laid out at Base and point Image at its sections, the image
+// is released if it doesn't check out
+bool AttachImage(image *Image, void *Base, size_t Size, bool Owned)
+{
+    *Image = (image){
+        .Base = Base,
+        .Size = Size,
+        .Owned = Owned,
+    };
+
+    if (Size < sizeof(image_header))
+    {
+        UnmapImage(Image);
+        return false;
+    }
+
+    const image_header *Header = Base;
+    Image->Header = (image_header){
+        .Magic = FromLE32(Header->Magic),
+        .Version = FromLE32(Header->Version),
+        .Length = FromLE64(Header->Length),
+        .SourceHash = FromLE64(Header->SourceHash),
+        .Flags = FromLE64(Header->Flags),
+    };
+
+    uint64_t Length = Image->Header.Length;
+    size_t Expected = sizeof(image_header) + sizeof(int64_t) * Length;
+    if (Image->Header.Flags & IMAGE_DECODED)
+    {
+        Expected += sizeof(imeta) * Length;
+    }
+
+    if (Image->Header.Magic != IMAGE_MAGIC ||
+        Image->Header.Version != IMAGE_VERSION ||
+        Length > MEMORY_SIZE ||
+        Size != Expected)
+    {
+        UnmapImage(Image);
+        return false;
+    }
+
+    Image->Words = (const int64_t *)(Header + 1);
+    if (Image->Header.Flags & IMAGE_DECODED)
+    {
+        Image->Meta = (const imeta *)(Image->Words + Length);
+    }
+    return true;
+}
+
+bool MapImage(const char *Path, image *Image)
+{
+    *Image = (image){0};
+
+#ifdef _WIN32
+    // No mmap, read a private copy instead
+    size_t Size;
+    void *Base = ReadSource(Path, &Size);
+    if (!Base)
+    {
+        return false;
+    }
+    return AttachImage(Image, Base, Size, true);
+#else
+    int Descriptor = open(Path, O_RDONLY);
+    if (Descriptor < 0)
+    {
+        return false;
+    }
+    struct stat Stat;
+    if (fstat(Descriptor, &Stat) != 0 || Stat.st_size < (off_t)sizeof(image_header))
+    {
+        close(Descriptor);
+        return false;
+    }
+    size_t Size = Stat.st_size;
+
+    // Read-only shared mapping, all processes share the same physical pages
+    void *Base = mmap(NULL, Size, PROT_READ, MAP_SHARED, Descriptor, 0);
+    close(Descriptor);
+    if (Base == MAP_FAILED)
+    {
+        return false;
+    }
+    return AttachImage(Image, Base, Size, false);
+#endif
+}
+
+void UnmapImage(image *Image)
+{
+    if (Image->Base)
+    {
+#ifndef _WIN32
+        if (!Image->Owned)
+        {
+            munmap(Image->Base, Image->Size);
+        }
+        else
+#endif
+        {
+            free(Image->Base);
+        }
+    }
+    *Image = (image){0};
+}
+
+// Map a program's image, (re)building it when it is missing or stale. The
+// image stays mapped until UnmapImage.
+void OpenImage(const char *Filename, image *Image)
+{
+    size_t Length;
+    char *Text = ReadSource(Filename, &Length);
+    if (!Text)
+    {
+        puts("No program file\n");
+        exit(1);
+    }
+    uint64_t Hash = HashSource(Text, Length);
+
+    char ImagePath[1024];
+    snprintf(ImagePath, sizeof(ImagePath), "%s%s", Filename, IMAGE_SUFFIX);
+
+    bool Mapped = MapImage(ImagePath, Image);
+    if (Mapped && Image->Header.SourceHash != Hash)
+    {
+        UnmapImage(Image);
+        Mapped = false;
+    }
+    if (!Mapped)
+    {
+        Mapped = ConvertImage(Filename, ImagePath, true) && MapImage(ImagePath, Image);
+    }
+    if (!Mapped)
+    {
+        // Read-only directory or similar, keep the image on the heap
+        size_t Size;
+        void *Base = BuildImage(Text, Length, true, &Size);
+        Mapped = AttachImage(Image, Base, Size, true);
+        assert(Mapped && "Program too big!");
+    }
+    free(Text);
+}
+
+// Copy an image into a computer's memory
+icv LoadImage(const image *Image, icv Memory[MEMORY_SIZE])
+{
+    icv Size = Image->Header.Length;
+    assert(Size <= MEMORY_SIZE);
+
+    if (IsLittleEndian())
+    {
+        memcpy(Memory, Image->Words, sizeof(icv) * Size);
+    }
+    else
+    {
+        for (icv i = 0; i < Size; ++i)
+        {
+            Memory[i] = FromLE64(Image->Words[i]);
+        }
+    }
+    return Size;
+}
+
+// Load a program through its image, for programs that are loaded once
+icv LoadMemoryImage(const char *Filename, icv Memory[MEMORY_SIZE])
+{
+    image Image;
+    OpenImage(Filename, &Image);
+    icv Size = LoadImage(&Image, Memory);
+    UnmapImage(&Image);
+    return Size;
+}
+
 //
 // Memory
 //
@@ -249,6 +718,39 @@ void Store(computer *Computer, icv Value)
     }
 }
 
+//
+// Batched I/O
+//
+
+/**
+ * With an input span OP_IN reads from the span and only interrupts once it is
+ * exhausted. With an output buffer OP_OUT appends to the buffer and only
+ * interrupts once it is full. Character-stream programs then stay in Run for
+ * whole lines or screens at a time.
+ **/
+
+// Feed inputs from a span, the span must outlive the run
+void SetInput(computer *Computer, const icv *Input, icv Length)
+{
+    Computer->InBuffer = Input;
+    Computer->InLength = Length;
+    Computer->InHead = 0;
+}
+
+// Collect outputs into a buffer, also used to drain it
+void SetOutput(computer *Computer, icv *Buffer, icv Capacity)
+{
+    assert(!Buffer || Capacity > 0);
+    Computer->OutBuffer = Buffer;
+    Computer->OutCapacity = Capacity;
+    Computer->OutLength = 0;
+}
+
+bool HasInput(computer *Computer)
+{
+    return Computer->InHead < Computer->InLength;
+}
+
 //
 // CPU
 //
@@ -264,7 +766,16 @@ interrupt Run(computer *Computer)
     if (GetInterrupt(Computer, INT_IN))
     {
         assert(Computer->Op.Opcode == OP_IN);
-        Store(Computer, Computer->In);
+
+        // A new input span takes precedence over the In slot
+        if (HasInput(Computer))
+        {
+            Store(Computer, Computer->InBuffer[Computer->InHead++]);
+        }
+        else
+        {
+            Store(Computer, Computer->In);
+        }
     }
 
     ClearInterrupts(Computer);
@@ -287,12 +798,27 @@ interrupt Run(computer *Computer)
         }
         case OP_IN:
         {
+            if (HasInput(Computer))
+            {
+                Store(Computer, Computer->InBuffer[Computer->InHead++]);
+                break;
+            }
+
             // We finish the operation after the interrupt is handled
             return SetInterrupt(Computer, INT_IN);
         }
         case OP_OUT:
         {
             Computer->Out = Load(Computer);
+            if (Computer->OutBuffer)
+            {
+                assert(Computer->OutLength < Computer->OutCapacity && "Output buffer not drained!");
+                Computer->OutBuffer[Computer->OutLength++] = Computer->Out;
+                if (Computer->OutLength < Computer->OutCapacity)
+                {
+                    break;
+                }
+            }
             return SetInterrupt(Computer, INT_OUT);
         }
         case OP_JT:
@@ -1,19 +1,34 @@
 #define INTCODE_IMPL
+#define SPRINGSCRIPT_IMPL
 
 #include "intcode.h"
+#include "springscript.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#define OUTPUT_SIZE 4096
+#define SYNTHESIZE 0 // Search for a script instead of using the one below
+#define HULL_CACHE "input.txt.walk.hulls"
+
 int main(void)
 {
-    icv Program[MEMORY_SIZE] = {0};
-    LoadMemory("input.txt", Program);
-
     computer Computer = {0};
-    memcpy(Computer.Memory, Program, sizeof(icv) * MEMORY_SIZE);
+    LoadMemoryImage("input.txt", Computer.Memory);
+
+#if SYNTHESIZE
+    // Hulls the droid fell on in earlier runs
+    hull_cache Cache = {0};
+    LoadHulls(HULL_CACHE, &Cache);
 
+    script Synthesized;
+    SynthesizeScript(Computer.Memory, &Cache, false, &Synthesized);
+    SaveHulls(HULL_CACHE, &Cache);
+
+    char Script[1024];
+    FormatScript(&Synthesized, Script, sizeof(Script));
+#else
     /**
      * Strategy:
      * 1. If there is a hole at any of ABC; and
@@ -21,7 +36,6 @@ int main(void)
      * 3. Jump; else, don't.
      **/
 
-    size_t Head = 0;
     char Script[] =
         "NOT J J\n" // J = 1
         "AND A J\n" // J &&= A
@@ -31,11 +45,37 @@ int main(void)
         "NOT J J\n" // J = !J
         "AND D J\n" // J &&= D
         "WALK\n";
+#endif
+
+    // Feed the whole script at once and collect a screen of output per run
+    icv Input[sizeof(Script)];
+    icv InputLength = strlen(Script);
+    for (icv i = 0; i < InputLength; ++i)
+    {
+        Input[i] = Script[i];
+    }
+    SetInput(&Computer, Input, InputLength);
+
+    icv Output[OUTPUT_SIZE];
 
     bool Done = false;
     while (!Done)
     {
+        SetOutput(&Computer, Output, OUTPUT_SIZE);
         interrupt Interrupt = Run(&Computer);
+
+        for (icv i = 0; i < Computer.OutLength; ++i)
+        {
+            if (Output[i] <= 127)
+            {
+                putchar(Output[i]);
+            }
+            else
+            {
+                printf("Amount of damage to the hull: %lld\n", Output[i]);
+            }
+        }
+
         switch (Interrupt)
         {
         case INT_HLT:
@@ -45,21 +85,12 @@ int main(void)
         }
         case INT_IN:
         {
-            assert(Head < sizeof(Script));
-            Computer.In = Script[Head++];
-            break;
+            printf("Script ended before the droid did\n");
+            exit(1);
         }
         case INT_OUT:
         {
-            icv Out = Computer.Out;
-            if (Out <= 127)
-            {
-                putchar(Computer.Out);
-            }
-            else
-            {
-                printf("Amount of damage to the hull: %lld\n", Out);
-            }
+            // Output buffer full, keep going
             break;
         }
         default:
@@ -0,0 +1,746 @@
+#ifndef __SPRINGSCRIPT_H__
+#define __SPRINGSCRIPT_H__
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intcode.h"
+
+/**
+ * SpringScript synthesizer.
+ *
+ * Every register holds a truth table with one bit per sensor state (A-I give
+ * 512 states), so one AND/OR/NOT on 64-bit words evaluates an instruction for
+ * 64 states at once. Programs are enumerated breadth-first over the (T, J)
+ * tables they produce, shortest first, and programs producing tables already
+ * seen are pruned. A candidate is first checked against a cache of hulls the
+ * droid fell on in earlier runs, and only goes to the Intcode VM to verify.
+ * A failed verification adds the new hull to the cache and the search starts
+ * over.
+ *
+ * Usage:
+ *
+ * hull_cache Cache = {0};
+ * LoadHulls("input.txt.run.hulls", &Cache);
+ *
+ * script Script;
+ * icv Damage = SynthesizeScript(Program, &Cache, true, &Script);
+ *
+ * SaveHulls("input.txt.run.hulls", &Cache);
+ **/
+
+#define SCRIPT_MAX_LENGTH 15 // Instructions the droid's memory can hold
+#define SENSOR_COUNT 9       // A-I
+#define STATE_COUNT (1 << SENSOR_COUNT)
+#define TABLE_WORDS (STATE_COUNT / 64)
+#define HULL_MAX 64
+#define SEARCH_MAX_NODES (8 * 1024 * 1024)
+
+// Registers, sensors first
+typedef enum
+{
+    REG_A = 0,
+    REG_E = 4,
+    REG_I = 8,
+    REG_T = 9,
+    REG_J = 10,
+    REG_COUNT = 11,
+} reg;
+
+typedef enum
+{
+    SS_AND,
+    SS_OR,
+    SS_NOT,
+} ss_op;
+
+typedef struct
+{
+    uint8_t Op;
+    uint8_t X;
+    uint8_t Y;
+} ss_instruction;
+
+typedef struct
+{
+    ss_instruction Code[SCRIPT_MAX_LENGTH];
+    int Length;
+    bool Run; // RUN (sensors A-I) or WALK (sensors A-D)
+} script;
+
+// A stretch of hull the droid fell on
+typedef struct
+{
+    char Tiles[HULL_MAX]; // '#' ground, '.' hole
+    int Length;
+    int Start; // Where the droid starts
+} hull;
+
+typedef struct
+{
+    hull *Hulls;
+    int Count;
+    int Capacity;
+} hull_cache;
+
+bool LoadHulls(const char *Path, hull_cache *Cache);
+bool SaveHulls(const char *Path, const hull_cache *Cache);
+bool AddHull(hull_cache *Cache, hull Hull);
+bool ParseHull(const char *Text, hull *Hull);
+void FormatScript(const script *Script, char *Buffer, size_t Size);
+bool FindScript(const hull_cache *Cache, bool Run, script *Script);
+icv VerifyScript(icv Program[MEMORY_SIZE], const script *Script, hull *Hull);
+icv SynthesizeScript(icv Program[MEMORY_SIZE], hull_cache *Cache, bool Run, script *Script);
+
+// Implementation
+
+#ifdef SPRINGSCRIPT_IMPL
+#undef SPRINGSCRIPT_IMPL
+
+const char REGISTERS[REG_COUNT] = "ABCDEFGHITJ";
+const char *SS_OPS[] = {[SS_AND] = "AND", [SS_OR] = "OR", [SS_NOT] = "NOT"};
+
+//
+// Hulls
+//
+
+bool AddHull(hull_cache *Cache, hull Hull)
+{
+    for (int i = 0; i < Cache->Count; ++i)
+    {
+        if (memcmp(&Cache->Hulls[i], &Hull, sizeof(hull)) == 0)
+        {
+            return false;
+        }
+    }
+    if (Cache->Count == Cache->Capacity)
+    {
+        Cache->Capacity = Cache->Capacity ? Cache->Capacity * 2 : 16;
+        Cache->Hulls = realloc(Cache->Hulls, sizeof(hull) * Cache->Capacity);
+        assert(Cache->Hulls);
+    }
+    Cache->Hulls[Cache->Count++] = Hull;
+    return true;
+}
+
+// One hull per line, the droid's start marked with '@' above the hull:
+//
+// @
+// #####..#.########
+bool LoadHulls(const char *Path, hull_cache *Cache)
+{
+    FILE *File = fopen(Path, "r");
+    if (!File)
+    {
+        return false;
+    }
+    char Marker[HULL_MAX + 2];
+    char Tiles[HULL_MAX + 2];
+    while (fgets(Marker, sizeof(Marker), File) && fgets(Tiles, sizeof(Tiles), File))
+    {
+        hull Hull = {0};
+        Hull.Start = strchr(Marker, '@') ? strchr(Marker, '@') - Marker : 0;
+        Hull.Length = strcspn(Tiles, "\r\n");
+        memcpy(Hull.Tiles, Tiles, Hull.Length);
+        AddHull(Cache, Hull);
+    }
+    fclose(File);
+    return true;
+}
+
+bool SaveHulls(const char *Path, const hull_cache *Cache)
+{
+    FILE *File = fopen(Path, "w");
+    if (!File)
+    {
+        return false;
+    }
+    for (int i = 0; i < Cache->Count; ++i)
+    {
+        const hull *Hull = &Cache->Hulls[i];
+        fprintf(File, "%*s@\n%.*s\n", Hull->Start, "", Hull->Length, Hull->Tiles);
+    }
+    return fclose(File) == 0;
+}
+
+// Find the hull in the droid's "Didn't make it across" animation, the first
+// frame has the droid at its start
+bool ParseHull(const char *Text, hull *Hull)
+{
+    const char *Droid = strchr(Text, '@');
+    if (!Droid)
+    {
+        return false;
+    }
+    const char *Line = Droid;
+    while (Line > Text && Line[-1] != '\n')
+    {
+        --Line;
+    }
+
+    *Hull = (hull){.Start = Droid - Line};
+
+    // The hull is the first line below the droid with ground on it
+    for (Line = strchr(Droid, '\n'); Line; Line = strchr(Line, '\n'))
+    {
+        ++Line;
+        int Length = strcspn(Line, "\n");
+        if (memchr(Line, '#', Length) && Length <= HULL_MAX)
+        {
+            memcpy(Hull->Tiles, Line, Length);
+            Hull->Length = Length;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sensor state of the droid standing at Position, beyond the end is ground
+int HullSensors(const hull *Hull, int Position)
+{
+    int State = 0;
+    for (int i = 0; i < SENSOR_COUNT; ++i)
+    {
+        int Tile = Position + 1 + i;
+        if (Tile >= Hull->Length || Hull->Tiles[Tile] == '#')
+        {
+            State |= 1 << i;
+        }
+    }
+    return State;
+}
+
+//
+// Scripts
+//
+
+void FormatScript(const script *Script, char *Buffer, size_t Size)
+{
+    size_t Length = 0;
+    for (int i = 0; i < Script->Length; ++i)
+    {
+        ss_instruction Instruction = Script->Code[i];
+        Length += snprintf(Buffer + Length, Size - Length, "%s %c %c\n",
+                           SS_OPS[Instruction.Op], REGISTERS[Instruction.X], REGISTERS[Instruction.Y]);
+        assert(Length < Size);
+    }
+    snprintf(Buffer + Length, Size - Length, Script->Run ? "RUN\n" : "WALK\n");
+}
+
+//
+// Search
+//
+
+/**
+ * Only sensor states the droid can see while standing on a cached hull
+ * matter, so the tables are packed down to those states. Two programs with
+ * the same packed (T, J) behave the same on every cached hull.
+ **/
+
+typedef struct
+{
+    int Parent;
+    ss_instruction Instruction;
+} search_node;
+
+// Open-addressing set of single tables
+typedef struct
+{
+    uint64_t *Keys; // Words per key
+    bool *Used;
+    int Words;
+    size_t Count;
+    size_t Capacity; // Power of two
+} table_set;
+
+typedef struct
+{
+    const hull_cache *Cache;
+    bool Run;
+    int Index[STATE_COUNT]; // Sensor state -> packed bit, -1 if never seen
+    int Words;              // Words per packed table
+    uint64_t Sensors[SENSOR_COUNT][TABLE_WORDS];
+    int *Bits;  // Packed bit of every hull position, HULL_MAX per hull
+    int *Order; // Hulls in checking order, the last one to reject goes first
+
+    search_node *Nodes;
+    uint64_t *Tables; // T then J, Words each, per node
+    int Count;
+    int Capacity;
+
+    int *Slots; // Open-addressing set of node indices, -1 if empty
+    int SlotCount;
+
+    // Final J instructions that only read J (or only T) give the same result
+    // for every node with that J (or T), so each is only checked once
+    table_set CheckedJ;
+    table_set CheckedT;
+} search;
+
+// Sensor state as seen by the droid, walking droids can't see past D
+int DroidSensors(search *Search, const hull *Hull, int Position)
+{
+    int State = HullSensors(Hull, Position);
+    return Search->Run ? State : State & 0xf;
+}
+
+table_set CreateTableSet(int Words)
+{
+    size_t Capacity = 1024;
+    table_set Set = {
+        .Keys = malloc(sizeof(uint64_t) * Words * Capacity),
+        .Used = calloc(Capacity, sizeof(bool)),
+        .Words = Words,
+        .Capacity = Capacity,
+    };
+    assert(Set.Keys && Set.Used);
+    return Set;
+}
+
+void DestroyTableSet(table_set *Set)
+{
+    free(Set->Keys);
+    free(Set->Used);
+}
+
+// Returns true if the table was not in the set yet
+bool InsertTable(table_set *Set, const uint64_t *Table)
+{
+    size_t Mask = Set->Capacity - 1;
+    uint64_t Hash = 0;
+    for (int i = 0; i < Set->Words; ++i)
+    {
+        Hash = (Hash ^ Table[i]) * 0x9e3779b97f4a7c15;
+        Hash ^= Hash >> 32;
+    }
+
+    size_t Slot = Hash & Mask;
+    while (Set->Used[Slot])
+    {
+        if (memcmp(Set->Keys + Slot * Set->Words, Table, sizeof(uint64_t) * Set->Words) == 0)
+        {
+            return false;
+        }
+        Slot = (Slot + 1) & Mask;
+    }
+    Set->Used[Slot] = true;
+    memcpy(Set->Keys + Slot * Set->Words, Table, sizeof(uint64_t) * Set->Words);
+
+    // Keep the load factor under 1/2
+    if (++Set->Count * 2 > Set->Capacity)
+    {
+        table_set Grown = {
+            .Keys = malloc(sizeof(uint64_t) * Set->Words * Set->Capacity * 2),
+            .Used = calloc(Set->Capacity * 2, sizeof(bool)),
+            .Words = Set->Words,
+            .Capacity = Set->Capacity * 2,
+        };
+        assert(Grown.Keys && Grown.Used);
+        for (size_t i = 0; i < Set->Capacity; ++i)
+        {
+            if (Set->Used[i])
+            {
+                InsertTable(&Grown, Set->Keys + i * Set->Words);
+            }
+        }
+        DestroyTableSet(Set);
+        *Set = Grown;
+    }
+    return true;
+}
+
+uint64_t *NodeTable(search *Search, int Node, reg Register)
+{
+    return Search->Tables + (size_t)Node * 2 * Search->Words + (Register == REG_J ? Search->Words : 0);
+}
+
+uint64_t HashTables(const uint64_t *Tables, int Words)
+{
+    uint64_t Hash = 0xcbf29ce484222325;
+    for (int i = 0; i < 2 * Words; ++i)
+    {
+        Hash ^= Tables[i];
+        Hash *= 0x9e3779b97f4a7c15;
+        Hash ^= Hash >> 32;
+    }
+    return Hash;
+}
+
+// Find the slot holding these tables or the empty slot they belong in
+int *FindSlot(search *Search, const uint64_t *Tables)
+{
+    size_t Mask = Search->SlotCount - 1;
+    size_t Slot = HashTables(Tables, Search->Words) & Mask;
+    for (;;)
+    {
+        int Node = Search->Slots[Slot];
+        if (Node < 0 ||
+            memcmp(NodeTable(Search, Node, REG_T), Tables, sizeof(uint64_t) * 2 * Search->Words) == 0)
+        {
+            return &Search->Slots[Slot];
+        }
+        Slot = (Slot + 1) & Mask;
+    }
+}
+
+void GrowSlots(search *Search)
+{
+    free(Search->Slots);
+    Search->SlotCount *= 2;
+    Search->Slots = malloc(sizeof(int) * Search->SlotCount);
+    assert(Search->Slots);
+    memset(Search->Slots, -1, sizeof(int) * Search->SlotCount);
+
+    for (int i = 0; i < Search->Count; ++i)
+    {
+        *FindSlot(Search, NodeTable(Search, i, REG_T)) = i;
+    }
+}
+
+// Add a node unless its tables were already reached, returns its index or -1
+int AddNode(search *Search, const uint64_t *Tables, int Parent, ss_instruction Instruction)
+{
+    int *Slot = FindSlot(Search, Tables);
+    if (*Slot >= 0)
+    {
+        return -1;
+    }
+
+    if (Search->Count == Search->Capacity)
+    {
+        Search->Capacity = Search->Capacity ? Search->Capacity * 2 : 1024;
+        Search->Nodes = realloc(Search->Nodes, sizeof(search_node) * Search->Capacity);
+        Search->Tables = realloc(Search->Tables, sizeof(uint64_t) * 2 * Search->Words * Search->Capacity);
+        assert(Search->Nodes && Search->Tables);
+    }
+
+    int Node = Search->Count++;
+    Search->Nodes[Node] = (search_node){.Parent = Parent, .Instruction = Instruction};
+    memcpy(NodeTable(Search, Node, REG_T), Tables, sizeof(uint64_t) * 2 * Search->Words);
+    *Slot = Node;
+
+    // Keep the load factor under 1/2
+    if (Search->Count * 2 > Search->SlotCount)
+    {
+        GrowSlots(Search);
+    }
+    return Node;
+}
+
+// Does a J table get the droid across every cached hull?
+bool CrossesHulls(search *Search, const uint64_t *J)
+{
+    const hull_cache *Cache = Search->Cache;
+    for (int i = 0; i < Cache->Count; ++i)
+    {
+        int Index = Search->Order[i];
+        const hull *Hull = &Cache->Hulls[Index];
+        const int *Bits = Search->Bits + Index * HULL_MAX;
+
+        int Position = Hull->Start;
+        while (Position < Hull->Length)
+        {
+            int Bit = Bits[Position];
+            bool Jump = (J[Bit / 64] >> (Bit % 64)) & 1;
+            Position += Jump ? 4 : 1;
+            if (Position < Hull->Length && Hull->Tiles[Position] == '.')
+            {
+                // Most candidates fail on the same few hulls
+                memmove(Search->Order + 1, Search->Order, sizeof(int) * i);
+                Search->Order[0] = Index;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void PrepareSearch(search *Search, const hull_cache *Cache, bool Run)
+{
+    *Search = (search){.Cache = Cache, .Run = Run};
+
+    // Pack every state the droid can stand in
+    int Packed = 0;
+    memset(Search->Index, -1, sizeof(Search->Index));
+    for (int i = 0; i < Cache->Count; ++i)
+    {
+        const hull *Hull = &Cache->Hulls[i];
+        for (int Position = 0; Position < Hull->Length; ++Position)
+        {
+            int State = DroidSensors(Search, Hull, Position);
+            if (Hull->Tiles[Position] == '#' && Search->Index[State] < 0)
+            {
+                Search->Index[State] = Packed++;
+            }
+        }
+    }
+    Search->Words = Packed > 0 ? (Packed + 63) / 64 : 1;
+
+    Search->CheckedJ = CreateTableSet(Search->Words);
+    Search->CheckedT = CreateTableSet(Search->Words);
+
+    Search->Bits = malloc(sizeof(int) * HULL_MAX * (Cache->Count + 1));
+    Search->Order = malloc(sizeof(int) * (Cache->Count + 1));
+    assert(Search->Bits && Search->Order);
+    for (int i = 0; i < Cache->Count; ++i)
+    {
+        const hull *Hull = &Cache->Hulls[i];
+        for (int Position = 0; Position < Hull->Length; ++Position)
+        {
+            Search->Bits[i * HULL_MAX + Position] = Search->Index[DroidSensors(Search, Hull, Position)];
+        }
+        Search->Order[i] = i;
+    }
+
+    for (int State = 0; State < STATE_COUNT; ++State)
+    {
+        int Bit = Search->Index[State];
+        if (Bit < 0)
+        {
+            continue;
+        }
+        for (int Sensor = 0; Sensor < SENSOR_COUNT; ++Sensor)
+        {
+            if ((State >> Sensor) & 1)
+            {
+                Search->Sensors[Sensor][Bit / 64] |= 1ull << (Bit % 64);
+            }
+        }
+    }
+
+    Search->SlotCount = 1024;
+    Search->Slots = malloc(sizeof(int) * Search->SlotCount);
+    assert(Search->Slots);
+    memset(Search->Slots, -1, sizeof(int) * Search->SlotCount);
+}
+
+void FreeSearch(search *Search)
+{
+    free(Search->Nodes);
+    free(Search->Tables);
+    free(Search->Slots);
+    free(Search->Bits);
+    free(Search->Order);
+    DestroyTableSet(&Search->CheckedJ);
+    DestroyTableSet(&Search->CheckedT);
+}
+
+void BuildScript(search *Search, int Node, bool Run, script *Script)
+{
+    *Script = (script){.Run = Run};
+    for (int i = Node; Search->Nodes[i].Parent >= 0; i = Search->Nodes[i].Parent)
+    {
+        ++Script->Length;
+    }
+    int Length = Script->Length;
+    for (int i = Node; Search->Nodes[i].Parent >= 0; i = Search->Nodes[i].Parent)
+    {
+        Script->Code[--Length] = Search->Nodes[i].Instruction;
+    }
+}
+
+// Run one instruction on a node's tables
+void Execute(search *Search, int Node, ss_instruction Instruction, uint64_t *Tables)
+{
+    int Words = Search->Words;
+    memcpy(Tables, NodeTable(Search, Node, REG_T), sizeof(uint64_t) * 2 * Words);
+
+    const uint64_t *Source = Instruction.X < REG_T ? Search->Sensors[Instruction.X] : NodeTable(Search, Node, Instruction.X);
+    uint64_t *Target = Instruction.Y == REG_T ? Tables : Tables + Words;
+    for (int i = 0; i < Words; ++i)
+    {
+        switch (Instruction.Op)
+        {
+        case SS_AND:
+            Target[i] &= Source[i];
+            break;
+        case SS_OR:
+            Target[i] |= Source[i];
+            break;
+        case SS_NOT:
+            Target[i] = ~Source[i];
+            break;
+        }
+    }
+}
+
+// Find a shortest script that crosses every cached hull
+bool FindScript(const hull_cache *Cache, bool Run, script *Script)
+{
+    search Search;
+    PrepareSearch(&Search, Cache, Run);
+
+    uint64_t Tables[2 * TABLE_WORDS] = {0};
+    uint64_t *J = Tables + Search.Words;
+
+    // T and J start out false
+    AddNode(&Search, Tables, -1, (ss_instruction){0});
+    if (CrossesHulls(&Search, J))
+    {
+        BuildScript(&Search, 0, Run, Script);
+        FreeSearch(&Search);
+        return true;
+    }
+
+    // Every instruction the droid accepts, minus sensors it doesn't have
+    ss_instruction Instructions[3 * REG_COUNT * 2];
+    int InstructionCount = 0;
+    for (int Op = SS_AND; Op <= SS_NOT; ++Op)
+    {
+        for (int X = 0; X < REG_COUNT; ++X)
+        {
+            for (int Y = REG_T; Y <= REG_J; ++Y)
+            {
+                // AND X X and OR X X do nothing
+                if ((X >= (Run ? REG_T : REG_E) && X < REG_T) || (Op != SS_NOT && X == Y))
+                {
+                    continue;
+                }
+                Instructions[InstructionCount++] = (ss_instruction){.Op = Op, .X = X, .Y = Y};
+            }
+        }
+    }
+
+    int LevelStart = 0;
+    int LevelEnd = Search.Count;
+
+    for (int Length = 1; Length <= SCRIPT_MAX_LENGTH; ++Length)
+    {
+        // Try to finish every shorter program with a write to J first, the
+        // next level is only worth storing if that fails
+        for (int Node = LevelStart; Node < LevelEnd; ++Node)
+        {
+            bool NewJ = InsertTable(&Search.CheckedJ, NodeTable(&Search, Node, REG_J));
+            bool NewT = InsertTable(&Search.CheckedT, NodeTable(&Search, Node, REG_T));
+
+            for (int i = 0; i < InstructionCount; ++i)
+            {
+                ss_instruction Instruction = Instructions[i];
+                bool ReadsT = Instruction.X == REG_T;
+                bool ReadsJ = Instruction.Op != SS_NOT || Instruction.X == REG_J;
+                if (Instruction.Y == REG_J &&
+                    ((ReadsT && ReadsJ) || (ReadsT && NewT) || (!ReadsT && ReadsJ && NewJ) ||
+                     (!ReadsT && !ReadsJ && Node == 0)))
+                {
+                    Execute(&Search, Node, Instruction, Tables);
+                    if (CrossesHulls(&Search, J))
+                    {
+                        BuildScript(&Search, Node, Run, Script);
+                        Script->Code[Script->Length++] = Instruction;
+                        FreeSearch(&Search);
+                        return true;
+                    }
+                }
+            }
+        }
+
+        if (Length == SCRIPT_MAX_LENGTH || Search.Count > SEARCH_MAX_NODES)
+        {
+            break;
+        }
+
+        for (int Node = LevelStart; Node < LevelEnd; ++Node)
+        {
+            for (int i = 0; i < InstructionCount; ++i)
+            {
+                Execute(&Search, Node, Instructions[i], Tables);
+                AddNode(&Search, Tables, Node, Instructions[i]);
+            }
+        }
+
+        LevelStart = LevelEnd;
+        LevelEnd = Search.Count;
+    }
+
+    FreeSearch(&Search);
+    return false;
+}
+
+//
+// Verification
+//
+
+// Run a script on the VM, returns the hull damage or -1 with the hull the
+// droid fell on
+icv VerifyScript(icv Program[MEMORY_SIZE], const script *Script, hull *Hull)
+{
+    char Text[1024];
+    FormatScript(Script, Text, sizeof(Text));
+
+    icv Input[sizeof(Text)];
+    icv InputLength = strlen(Text);
+    for (icv i = 0; i < InputLength; ++i)
+    {
+        Input[i] = Text[i];
+    }
+
+    static computer Computer;
+    memset(&Computer, 0, sizeof(Computer));
+    memcpy(Computer.Memory, Program, sizeof(icv) * MEMORY_SIZE);
+    SetInput(&Computer, Input, InputLength);
+
+    // The failure animation is a few KiB of text
+    static icv Output[64 * 1024];
+    SetOutput(&Computer, Output, sizeof(Output) / sizeof(Output[0]));
+
+    interrupt Interrupt = Run(&Computer);
+    if (Interrupt != INT_HLT)
+    {
+        printf("Unexpected interrupt while verifying: %d\n", Interrupt);
+        exit(1);
+    }
+
+    icv Last = Computer.OutLength > 0 ? Output[Computer.OutLength - 1] : 0;
+    if (Last > 127)
+    {
+        return Last;
+    }
+
+    static char Animation[64 * 1024 + 1];
+    for (icv i = 0; i < Computer.OutLength; ++i)
+    {
+        Animation[i] = Output[i];
+    }
+    Animation[Computer.OutLength] = '\0';
+
+    if (!ParseHull(Animation, Hull))
+    {
+        printf("No hull in the droid's output:\n%s\n", Animation);
+        exit(1);
+    }
+    return -1;
+}
+
+// Search and verify until a script makes it across, returns the hull damage
+icv SynthesizeScript(icv Program[MEMORY_SIZE], hull_cache *Cache, bool Run, script *Script)
+{
+    for (;;)
+    {
+        if (!FindScript(Cache, Run, Script))
+        {
+            puts("No script crosses every cached hull");
+            exit(1);
+        }
+
+        hull Hull;
+        icv Damage = VerifyScript(Program, Script, &Hull);
+        if (Damage >= 0)
+        {
+            return Damage;
+        }
+
+        if (!AddHull(Cache, Hull))
+        {
+            // Our hull model disagrees with the droid
+            printf("Script fell on a cached hull: %.*s\n", Hull.Length, Hull.Tiles);
+            exit(1);
+        }
+    }
+}
+
+#endif
+
+#endif
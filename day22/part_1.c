@@ -1,10 +1,18 @@
 #include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 #define DECK_SIZE 10007
 #define SHUFFLE_MAX 100
+#define AFFINE 1 // Track where cards go and build the deck once at the end
+#define DECK_LANES 8 // One AVX2 register of cards
 
 typedef enum
 {
@@ -137,11 +145,128 @@ void PrintDeck(int Deck[DECK_SIZE])
     putchar('\n');
 }
 
+// A card at position X ends up at A*X + B (mod DECK_SIZE), products fit
+// in 64 bits for any deck that fits in memory
+typedef struct
+{
+    int64_t A;
+    int64_t B;
+} affine;
+
+int64_t Mod(int64_t X, int64_t M)
+{
+    X %= M;
+    return X < 0 ? X + M : X;
+}
+
+// Inverse of X mod M through the extended Euclidean algorithm, X and M must be coprime
+int64_t InvMod(int64_t X, int64_t M)
+{
+    int64_t R0 = M, R1 = Mod(X, M);
+    int64_t T0 = 0, T1 = 1;
+    while (R1 != 0)
+    {
+        int64_t Q = R0 / R1;
+        int64_t R2 = R0 - Q * R1;
+        int64_t T2 = T0 - Q * T1;
+        R0 = R1, R1 = R2;
+        T0 = T1, T1 = T2;
+    }
+    if (R0 != 1)
+    {
+        fprintf(stderr, "%" PRId64 " has no inverse mod %" PRId64 "\n", X, M);
+        exit(1);
+    }
+    return Mod(T0, M);
+}
+
+// First F, then G
+affine Compose(affine F, affine G)
+{
+    return (affine){
+        .A = G.A * F.A % DECK_SIZE,
+        .B = (G.A * F.B + G.B) % DECK_SIZE,
+    };
+}
+
+affine ShuffleMap(shuffle Shuffle)
+{
+    switch (Shuffle.Technique)
+    {
+    case ST_DEAL_INTO_NEW_STACK:
+    {
+        return (affine){.A = DECK_SIZE - 1, .B = DECK_SIZE - 1}; // -X - 1
+    }
+    case ST_CUT_N_CARDS:
+    {
+        return (affine){.A = 1, .B = Mod(-Shuffle.N, DECK_SIZE)};
+    }
+    case ST_DEAL_WITH_INCREMENT_N:
+    {
+        return (affine){.A = Mod(Shuffle.N, DECK_SIZE), .B = 0};
+    }
+    default:
+    {
+        fprintf(stderr, "Invalid shuffle technique");
+        exit(1);
+    }
+    }
+}
+
+// Deck[X] = Map(X), the card that ends up at X. Cards are worked out a
+// block of lanes at a time, each lane a fixed offset from the block's first
+// card, so moving on a block is an add and at most one wrap around the deck.
+void BuildDeck(int Deck[DECK_SIZE], affine Map)
+{
+    int Offsets[DECK_LANES];
+    for (int Lane = 0; Lane < DECK_LANES; ++Lane)
+    {
+        Offsets[Lane] = Map.A * Lane % DECK_SIZE;
+    }
+    int Stride = Map.A * DECK_LANES % DECK_SIZE;
+
+    int Start = Map.B;
+    int Index = 0;
+#ifdef __AVX2__
+    __m256i LaneOffsets = _mm256_loadu_si256((const __m256i *)Offsets);
+    __m256i Size = _mm256_set1_epi32(DECK_SIZE);
+    __m256i Last = _mm256_set1_epi32(DECK_SIZE - 1);
+    for (; Index + DECK_LANES <= DECK_SIZE; Index += DECK_LANES)
+    {
+        __m256i Card = _mm256_add_epi32(_mm256_set1_epi32(Start), LaneOffsets);
+        Card = _mm256_sub_epi32(Card, _mm256_and_si256(_mm256_cmpgt_epi32(Card, Last), Size));
+        _mm256_storeu_si256((__m256i *)&Deck[Index], Card);
+
+        Start += Stride;
+        Start -= Start >= DECK_SIZE ? DECK_SIZE : 0;
+    }
+#endif
+    for (; Index + DECK_LANES <= DECK_SIZE; Index += DECK_LANES)
+    {
+        for (int Lane = 0; Lane < DECK_LANES; ++Lane)
+        {
+            int Card = Start + Offsets[Lane];
+            Deck[Index + Lane] = Card >= DECK_SIZE ? Card - DECK_SIZE : Card;
+        }
+        Start += Stride;
+        Start -= Start >= DECK_SIZE ? DECK_SIZE : 0;
+    }
+    for (int Lane = 0; Index < DECK_SIZE; ++Index, ++Lane)
+    {
+        int Card = Start + Offsets[Lane];
+        Deck[Index] = Card >= DECK_SIZE ? Card - DECK_SIZE : Card;
+    }
+}
+
 int main(void)
 {
-    int Deck[DECK_SIZE] = {0};
+    static int Deck[DECK_SIZE] = {0};
     InitDeck(Deck);
 
+#if AFFINE
+    affine Shuffled = {.A = 1, .B = 0};
+#endif
+
     shuffle ShuffleProcess[SHUFFLE_MAX] = {0};
     size_t ShuffleProcessCount = LoadShuffleProcess("input.txt", ShuffleProcess);
 
@@ -153,6 +278,9 @@ int main(void)
         // PrintDeck(Deck);
         printf("\n");
 
+#if AFFINE
+        Shuffled = Compose(Shuffled, ShuffleMap(Shuffle));
+#else
         switch (Shuffle.Technique)
         {
         case ST_DEAL_INTO_NEW_STACK:
@@ -176,8 +304,16 @@ int main(void)
             exit(1);
         }
         }
+#endif
     }
 
+#if AFFINE
+    // The card that ends up at X started at the inverse of the map at X
+    int64_t Inverse = InvMod(Shuffled.A, DECK_SIZE);
+    affine Unshuffled = {.A = Inverse, .B = Mod(-Inverse * Shuffled.B, DECK_SIZE)};
+    BuildDeck(Deck, Unshuffled);
+#endif
+
     // printf("Result: ");
     // PrintDeck(Deck);
 
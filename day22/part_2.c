@@ -7,6 +7,9 @@
 #include <stdint.h>
 
 #define SHUFFLE_MAX 100
+#define DECK_SIZE 119315717514047
+#define SHUFFLE_COUNT 101741582076661
+#define CARD_POSITION 2020
 
 typedef enum
 {
@@ -64,43 +67,116 @@ size_t LoadShuffleProcess(const char *Filename, shuffle Process[SHUFFLE_MAX])
     return Count;
 }
 
-// Take the output index of a card and return the index it started at before the shuffle process
-int64_t Unshuffle(int64_t Card, int64_t DeckSize, shuffle Process[SHUFFLE_MAX], size_t ProcessCount)
+// A card at position X ends up at A*X + B (mod the deck size)
+typedef struct
+{
+    int64_t A;
+    int64_t B;
+} affine;
+
+int64_t Mod(int64_t X, int64_t M)
 {
-    int64_t Out = Card;
+    X %= M;
+    return X < 0 ? X + M : X;
+}
 
-    for (int64_t Index = 0; Index < ProcessCount; ++Index)
+// X*Y mod M without overflowing, deck sizes take up to 47 bits
+int64_t MulMod(int64_t X, int64_t Y, int64_t M)
+{
+#ifdef __SIZEOF_INT128__
+    return (int64_t)((unsigned __int128)X * (unsigned __int128)Y % (unsigned __int128)M);
+#else
+    // Double and add, X and Y are already reduced
+    uint64_t Result = 0;
+    uint64_t Base = X;
+    for (uint64_t Bits = Y; Bits; Bits >>= 1)
     {
-        shuffle Shuffle = Process[Index];
+        if (Bits & 1)
+        {
+            Result = Result >= M - Base ? Result - (M - Base) : Result + Base;
+        }
+        Base = Base >= M - Base ? Base - (M - Base) : Base + Base;
+    }
+    return (int64_t)Result;
+#endif
+}
+
+// Inverse of X mod M through the extended Euclidean algorithm, X and M must be coprime
+int64_t InvMod(int64_t X, int64_t M)
+{
+    int64_t R0 = M, R1 = Mod(X, M);
+    int64_t T0 = 0, T1 = 1;
+    while (R1 != 0)
+    {
+        int64_t Q = R0 / R1;
+        int64_t R2 = R0 - Q * R1;
+        int64_t T2 = T0 - Q * T1; // |T| stays below M so this can't overflow
+        R0 = R1, R1 = R2;
+        T0 = T1, T1 = T2;
+    }
+    if (R0 != 1)
+    {
+        fprintf(stderr, "%" PRId64 " has no inverse mod %" PRId64 "\n", X, M);
+        exit(1);
+    }
+    return Mod(T0, M);
+}
+
+// First F, then G
+affine Compose(affine F, affine G, int64_t M)
+{
+    return (affine){
+        .A = MulMod(G.A, F.A, M),
+        .B = Mod(MulMod(G.A, F.B, M) + G.B, M),
+    };
+}
+
+// F applied Count times, by squaring
+affine Repeat(affine F, int64_t Count, int64_t M)
+{
+    affine Result = {.A = 1, .B = 0};
+    for (; Count > 0; Count >>= 1)
+    {
+        if (Count & 1)
+        {
+            Result = Compose(Result, F, M);
+        }
+        F = Compose(F, F, M);
+    }
+    return Result;
+}
 
-        // printf("%zu\t%-25s\t%" PRId64 "\n", Index, SHUFFLE_TECHNIQUE_NAMES[Shuffle.Technique], Shuffle.N);
+// Position the card at X came from
+int64_t Invert(affine F, int64_t X, int64_t M)
+{
+    return MulMod(Mod(X - F.B, M), InvMod(F.A, M), M);
+}
 
+// The whole shuffle process as a single map on card positions
+affine ComposeShuffle(int64_t DeckSize, shuffle Process[SHUFFLE_MAX], size_t ProcessCount)
+{
+    affine Result = {.A = 1, .B = 0};
+
+    for (size_t Index = 0; Index < ProcessCount; ++Index)
+    {
+        shuffle Shuffle = Process[Index];
+
+        affine Step;
         switch (Shuffle.Technique)
         {
         case ST_DEAL_INTO_NEW_STACK:
         {
-            Out = DeckSize - 1 - Out; // Mirror the card to the other side of the deck
+            Step = (affine){.A = DeckSize - 1, .B = DeckSize - 1}; // -X - 1
             break;
         }
         case ST_CUT_N_CARDS:
         {
-            int64_t N = -Shuffle.N; // Mirror N to reverse
-            if (N < 0)
-            {
-                N += DeckSize;
-            }
-            Out = (Out + N) % DeckSize;
+            Step = (affine){.A = 1, .B = Mod(-Shuffle.N, DeckSize)};
             break;
         }
         case ST_DEAL_WITH_INCREMENT_N:
         {
-            int64_t N = Shuffle.N;
-
-            // Michael's formula
-            int64_t Round = N * Out / DeckSize;
-            int64_t Index = N * Out - DeckSize * Round;
-
-            Out = Index;
+            Step = (affine){.A = Mod(Shuffle.N, DeckSize), .B = 0};
             break;
         }
         default:
@@ -110,47 +186,22 @@ int64_t Unshuffle(int64_t Card, int64_t DeckSize, shuffle Process[SHUFFLE_MAX],
         }
         }
 
-        // printf("Out: %llu\n", Out);
+        Result = Compose(Result, Step, DeckSize);
     }
 
-    return Out;
+    return Result;
 }
 
 int main(void)
 {
-    // Keep track of the amount we have to add to each position when we
-    // calculate it (as an integer)
-
-    int64_t CardPosition = 7;
-    int64_t ShuffleCount = 1;
-
-    int64_t DeckSize = 10;
-
     shuffle ShuffleProcess[SHUFFLE_MAX] = {0};
     size_t ShuffleProcessCount = LoadShuffleProcess("input.txt", ShuffleProcess);
 
-    int64_t Deck[] = {0, 3, 6, 9, 2, 5, 8, 1, 4, 7};
-
-    for (int64_t Card = 0; Card < DeckSize; ++Card)
-    {
-        int64_t Out = Unshuffle(Deck[Card], DeckSize, ShuffleProcess, ShuffleProcessCount);
-
-        printf("%" PRId64 " (%" PRId64 ") -> %" PRId64 "\n", Card, Deck[Card], Out);
-    }
-
-    // Print thousands separators in numbers
-    setlocale(LC_NUMERIC, "");
-
-    int64_t Out = CardPosition;
-    for (int64_t N = 0; N < ShuffleCount; ++N)
-    {
-        Out = Unshuffle(Out, DeckSize, ShuffleProcess, ShuffleProcessCount);
-
-        if (N % 1000000 == 0)
-        {
-            printf("%'" PRId64 "\t%" PRId64 "\n", N, Out);
-        }
-    }
+    // Every repetition composes into one map, so finding where a card came
+    // from takes O(log repetitions) instead of one pass per repetition
+    affine Shuffle = ComposeShuffle(DECK_SIZE, ShuffleProcess, ShuffleProcessCount);
+    affine Shuffles = Repeat(Shuffle, SHUFFLE_COUNT, DECK_SIZE);
+    int64_t Card = Invert(Shuffles, CARD_POSITION, DECK_SIZE);
 
-    printf("Card at position %" PRId64 " is %" PRId64 "\n", CardPosition, Out);
+    printf("Card at position %" PRId64 " is %" PRId64 "\n", (int64_t)CARD_POSITION, Card);
 }
@@ -10,39 +10,50 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#define SWEEP 1 // Sort the runs and sweep instead of testing every pair
+
 struct vec
 {
     int X, Y;
 };
 
-int LoadCable(FILE* File, struct vec Cable[])
+struct vec CentralPort = { 1, 1 };
+
+int LoadCable(FILE* File, struct vec** Cable)
 {    
     int Count = 0;
+    int Capacity = 1024;
+    *Cable = malloc(sizeof(struct vec) * Capacity);
     char Direction;
     int Distance;
     char Delimiter;
     while(fscanf(File, "%c%d%c[^\n]", &Direction, &Distance, &Delimiter) != EOF)
     {
+        if(Count == Capacity)
+        {
+            Capacity *= 2;
+            *Cable = realloc(*Cable, sizeof(struct vec) * Capacity);
+        }
         switch(Direction)
         {
             case 'U':
             {
-                Cable[Count++] = (struct vec) { .Y = Distance };
+                (*Cable)[Count++] = (struct vec) { .Y = Distance };
                 break;
             }
             case 'D':
             {
-                Cable[Count++] = (struct vec) { .Y = -Distance };
+                (*Cable)[Count++] = (struct vec) { .Y = -Distance };
                 break;
             }
             case 'L':
             {
-                Cable[Count++] = (struct vec) { .X = -Distance };
+                (*Cable)[Count++] = (struct vec) { .X = -Distance };
                 break;
             }
             case 'R':
             {
-                Cable[Count++] = (struct vec) { .X = Distance };
+                (*Cable)[Count++] = (struct vec) { .X = Distance };
                 break;
             }
             default:
@@ -97,22 +108,254 @@ int Distance(struct vec From, struct vec To)
     return abs(To.X - From.X) + abs(To.Y - From.Y);
 }
 
-int main(void)
+// A straight run of cable. Fixed is the row of a horizontal run or the
+// column of a vertical one, Low and High are its ends along the other axis.
+struct segment
+{
+    int Fixed;
+    int Low, High;
+};
+
+// Sorts runs into horizontal and vertical ones
+void SplitCable(int Count, struct vec Cable[], struct segment Horizontal[], int* HorizontalCount, struct segment Vertical[], int* VerticalCount)
+{
+    struct vec Head = CentralPort;
+    for(int i = 0; i < Count; ++i)
+    {
+        struct vec Move = Cable[i];
+        if(Move.Y == 0)
+        {
+            int End = Head.X + Move.X;
+            Horizontal[(*HorizontalCount)++] = (struct segment)
+            {
+                .Fixed = Head.Y,
+                .Low = Head.X < End ? Head.X : End,
+                .High = Head.X < End ? End : Head.X
+            };
+        }
+        else
+        {
+            int End = Head.Y + Move.Y;
+            Vertical[(*VerticalCount)++] = (struct segment)
+            {
+                .Fixed = Head.X,
+                .Low = Head.Y < End ? Head.Y : End,
+                .High = Head.Y < End ? End : Head.Y
+            };
+        }
+        Head.X += Move.X;
+        Head.Y += Move.Y;
+    }
+}
+
+int CompareRows(const void* A, const void* B)
 {
-    struct vec CentralPort = { 1, 1 };
+    int RowA = ((const struct segment*)A)->Fixed;
+    int RowB = ((const struct segment*)B)->Fixed;
+    return (RowA > RowB) - (RowA < RowB);
+}
+
+// At the same column runs that end there are gone before the vertical runs
+// look for crossings, and runs that start there only come in after, so
+// crossings are strictly inside both runs like in Intersection()
+enum event_kind
+{
+    EVENT_END,
+    EVENT_CROSS,
+    EVENT_START
+};
+
+struct event
+{
+    int X;
+    int Kind;
+    int Index;
+};
 
+int CompareEvents(const void* A, const void* B)
+{
+    const struct event* EventA = A;
+    const struct event* EventB = B;
+    if(EventA->X != EventB->X)
+    {
+        return (EventA->X > EventB->X) - (EventA->X < EventB->X);
+    }
+    return EventA->Kind - EventB->Kind;
+}
+
+// Horizontal runs under the sweep line, one slot per run in row order.
+// Counts is a tree of how many slots are taken under each node.
+struct active_set
+{
+    int* Counts;
+    int Size;
+};
+
+static inline
+void Toggle(struct active_set* Set, int Slot, int Delta)
+{
+    for(int Node = Slot + Set->Size; Node > 0; Node /= 2)
+    {
+        Set->Counts[Node] += Delta;
+    }
+}
+
+// First taken slot from Slot on, or -1
+int NextActive(struct active_set* Set, int Slot)
+{
+    if(Slot >= Set->Size)
+    {
+        return -1;
+    }
+    int Node = Slot + Set->Size;
+    if(Set->Counts[Node] == 0)
+    {
+        // Climb until there's a taken subtree to the right, then take its
+        // leftmost slot
+        for(;;)
+        {
+            if(Node == 1)
+            {
+                return -1;
+            }
+            if(Node % 2 == 0 && Set->Counts[Node + 1] > 0)
+            {
+                ++Node;
+                break;
+            }
+            Node /= 2;
+        }
+        while(Node < Set->Size)
+        {
+            Node = Set->Counts[2 * Node] > 0 ? 2 * Node : 2 * Node + 1;
+        }
+    }
+    return Node - Set->Size;
+}
+
+// Keeps the crossing closest to the central port
+struct crossings
+{
+    long long Best;
+};
+
+static inline
+void AddCrossing(struct crossings* Crossings, struct vec Point)
+{
+    long long PortDistance = (long long)abs(Point.X - CentralPort.X) + abs(Point.Y - CentralPort.Y);
+    if(Crossings->Best > PortDistance)
+    {
+        Crossings->Best = PortDistance;
+    }
+}
+
+// Crossings of one cable's horizontal runs with the other's vertical runs.
+// Sweeping left to right, each vertical run only visits the horizontal runs
+// it actually crosses.
+void FindCrossings(int HorizontalCount, struct segment Horizontal[], int VerticalCount, struct segment Vertical[], struct crossings* Crossings)
+{
+    if(HorizontalCount == 0 || VerticalCount == 0)
+    {
+        return;
+    }
+
+    qsort(Horizontal, HorizontalCount, sizeof(struct segment), CompareRows);
+
+    int EventCount = 0;
+    struct event* Events = malloc(sizeof(struct event) * (2 * HorizontalCount + VerticalCount));
+    for(int i = 0; i < HorizontalCount; ++i)
+    {
+        if(Horizontal[i].Low == Horizontal[i].High)
+        {
+            continue; // Nothing is strictly inside, and it would end before it starts
+        }
+        Events[EventCount++] = (struct event){ Horizontal[i].Low, EVENT_START, i };
+        Events[EventCount++] = (struct event){ Horizontal[i].High, EVENT_END, i };
+    }
+    for(int i = 0; i < VerticalCount; ++i)
+    {
+        Events[EventCount++] = (struct event){ Vertical[i].Fixed, EVENT_CROSS, i };
+    }
+    qsort(Events, EventCount, sizeof(struct event), CompareEvents);
+
+    struct active_set Set = { .Size = 1 };
+    while(Set.Size < HorizontalCount)
+    {
+        Set.Size *= 2;
+    }
+    Set.Counts = calloc(2 * Set.Size, sizeof(int));
+
+    for(int i = 0; i < EventCount; ++i)
+    {
+        struct event* Event = &Events[i];
+        if(Event->Kind == EVENT_START)
+        {
+            Toggle(&Set, Event->Index, 1);
+        }
+        else if(Event->Kind == EVENT_END)
+        {
+            Toggle(&Set, Event->Index, -1);
+        }
+        else
+        {
+            struct segment* Run = &Vertical[Event->Index];
+
+            // First row above the bottom of the run
+            int Low = 0;
+            int High = HorizontalCount;
+            while(Low < High)
+            {
+                int Middle = Low + (High - Low) / 2;
+                if(Horizontal[Middle].Fixed <= Run->Low)
+                {
+                    Low = Middle + 1;
+                }
+                else
+                {
+                    High = Middle;
+                }
+            }
+
+            for(int Slot = NextActive(&Set, Low);
+                Slot != -1 && Horizontal[Slot].Fixed < Run->High;
+                Slot = NextActive(&Set, Slot + 1))
+            {
+                AddCrossing(Crossings, (struct vec){ Run->Fixed, Horizontal[Slot].Fixed });
+            }
+        }
+    }
+
+    free(Set.Counts);
+    free(Events);
+}
+
+int main(void)
+{
     FILE* Input = fopen("day3_input.txt", "r");
 
-    struct vec Cable1[1024];
-    struct vec Cable2[1024];
+    struct vec* Cable1;
+    struct vec* Cable2;
 
-    int Count1 = LoadCable(Input, Cable1);
-    int Count2 = LoadCable(Input, Cable2);
+    int Count1 = LoadCable(Input, &Cable1);
+    int Count2 = LoadCable(Input, &Cable2);
+    fclose(Input);
 
-    struct vec Intersections[1024];
-    int IntersectionCount;
+#if SWEEP
+    struct segment* Horizontal1 = malloc(sizeof(struct segment) * Count1);
+    struct segment* Vertical1 = malloc(sizeof(struct segment) * Count1);
+    struct segment* Horizontal2 = malloc(sizeof(struct segment) * Count2);
+    struct segment* Vertical2 = malloc(sizeof(struct segment) * Count2);
+    int HorizontalCount1 = 0, VerticalCount1 = 0;
+    int HorizontalCount2 = 0, VerticalCount2 = 0;
+    SplitCable(Count1, Cable1, Horizontal1, &HorizontalCount1, Vertical1, &VerticalCount1);
+    SplitCable(Count2, Cable2, Horizontal2, &HorizontalCount2, Vertical2, &VerticalCount2);
 
-    int MinDistance = INT_MAX;
+    struct crossings Crossings = { .Best = LLONG_MAX };
+    FindCrossings(HorizontalCount1, Horizontal1, VerticalCount2, Vertical2, &Crossings);
+    FindCrossings(HorizontalCount2, Horizontal2, VerticalCount1, Vertical1, &Crossings);
+    long long MinDistance = Crossings.Best;
+#else
+    long long MinDistance = LLONG_MAX;
 
     struct vec Head1 = CentralPort;
     for(int i = 0; i < Count1; ++i)
@@ -136,6 +379,7 @@ int main(void)
         Head1.X += Cable1[i].X;
         Head1.Y += Cable1[i].Y;
     }
+#endif
 
-    printf("Result: %d\n", MinDistance);
+    printf("Result: %lld\n", MinDistance);
 }
@@ -11,6 +11,8 @@
 #include <stdlib.h>
 #include <time.h>
 
+#define SWEEP 1 // Sort the runs and sweep instead of testing every pair
+
 struct vec
 {
     int X, Y;
@@ -19,34 +21,41 @@ struct vec
 struct vec CentralPort = { 1, 1 };
 
 static inline
-int LoadCable(FILE* File, struct vec Cable[])
+int LoadCable(FILE* File, struct vec** Cable)
 {    
     int Count = 0;
+    int Capacity = 1024;
+    *Cable = malloc(sizeof(struct vec) * Capacity);
     char Direction;
     int Distance;
     char Delimiter;
     while(fscanf(File, "%c%d%c[^\n]", &Direction, &Distance, &Delimiter) != EOF)
     {
+        if(Count == Capacity)
+        {
+            Capacity *= 2;
+            *Cable = realloc(*Cable, sizeof(struct vec) * Capacity);
+        }
         switch(Direction)
         {
             case 'U':
             {
-                Cable[Count++] = (struct vec) { .Y = Distance };
+                (*Cable)[Count++] = (struct vec) { .Y = Distance };
                 break;
             }
             case 'D':
             {
-                Cable[Count++] = (struct vec) { .Y = -Distance };
+                (*Cable)[Count++] = (struct vec) { .Y = -Distance };
                 break;
             }
             case 'L':
             {
-                Cable[Count++] = (struct vec) { .X = -Distance };
+                (*Cable)[Count++] = (struct vec) { .X = -Distance };
                 break;
             }
             case 'R':
             {
-                Cable[Count++] = (struct vec) { .X = Distance };
+                (*Cable)[Count++] = (struct vec) { .X = Distance };
                 break;
             }
             default:
@@ -149,6 +158,348 @@ int PathLength(int Count, struct vec Cable[], struct vec Point)
     exit(1);
 }
 
+// A straight run of cable. Fixed is the row of a horizontal run or the
+// column of a vertical one, Low and High are its ends along the other axis.
+struct segment
+{
+    int Fixed;
+    int Low, High;
+};
+
+// Sorts runs into horizontal and vertical ones
+void SplitCable(int Count, struct vec Cable[], struct segment Horizontal[], int* HorizontalCount, struct segment Vertical[], int* VerticalCount)
+{
+    struct vec Head = CentralPort;
+    for(int i = 0; i < Count; ++i)
+    {
+        struct vec Move = Cable[i];
+        if(Move.Y == 0)
+        {
+            int End = Head.X + Move.X;
+            Horizontal[(*HorizontalCount)++] = (struct segment)
+            {
+                .Fixed = Head.Y,
+                .Low = Head.X < End ? Head.X : End,
+                .High = Head.X < End ? End : Head.X
+            };
+        }
+        else
+        {
+            int End = Head.Y + Move.Y;
+            Vertical[(*VerticalCount)++] = (struct segment)
+            {
+                .Fixed = Head.X,
+                .Low = Head.Y < End ? Head.Y : End,
+                .High = Head.Y < End ? End : Head.Y
+            };
+        }
+        Head.X += Move.X;
+        Head.Y += Move.Y;
+    }
+}
+
+int CompareRows(const void* A, const void* B)
+{
+    int RowA = ((const struct segment*)A)->Fixed;
+    int RowB = ((const struct segment*)B)->Fixed;
+    return (RowA > RowB) - (RowA < RowB);
+}
+
+// At the same column runs that end there are gone before the vertical runs
+// look for crossings, and runs that start there only come in after, so
+// crossings are strictly inside both runs like in Intersection()
+enum event_kind
+{
+    EVENT_END,
+    EVENT_CROSS,
+    EVENT_START
+};
+
+struct event
+{
+    int X;
+    int Kind;
+    int Index;
+};
+
+int CompareEvents(const void* A, const void* B)
+{
+    const struct event* EventA = A;
+    const struct event* EventB = B;
+    if(EventA->X != EventB->X)
+    {
+        return (EventA->X > EventB->X) - (EventA->X < EventB->X);
+    }
+    return EventA->Kind - EventB->Kind;
+}
+
+// Horizontal runs under the sweep line, one slot per run in row order.
+// Counts is a tree of how many slots are taken under each node.
+struct active_set
+{
+    int* Counts;
+    int Size;
+};
+
+static inline
+void Toggle(struct active_set* Set, int Slot, int Delta)
+{
+    for(int Node = Slot + Set->Size; Node > 0; Node /= 2)
+    {
+        Set->Counts[Node] += Delta;
+    }
+}
+
+// First taken slot from Slot on, or -1
+int NextActive(struct active_set* Set, int Slot)
+{
+    if(Slot >= Set->Size)
+    {
+        return -1;
+    }
+    int Node = Slot + Set->Size;
+    if(Set->Counts[Node] == 0)
+    {
+        // Climb until there's a taken subtree to the right, then take its
+        // leftmost slot
+        for(;;)
+        {
+            if(Node == 1)
+            {
+                return -1;
+            }
+            if(Node % 2 == 0 && Set->Counts[Node + 1] > 0)
+            {
+                ++Node;
+                break;
+            }
+            Node /= 2;
+        }
+        while(Node < Set->Size)
+        {
+            Node = Set->Counts[2 * Node] > 0 ? 2 * Node : 2 * Node + 1;
+        }
+    }
+    return Node - Set->Size;
+}
+
+// Every crossing, the steps to them are worked out once they're all found
+struct crossings
+{
+    struct vec* Points;
+    int Count;
+    int Capacity;
+};
+
+static inline
+void AddCrossing(struct crossings* Crossings, struct vec Point)
+{
+    if(Crossings->Count == Crossings->Capacity)
+    {
+        Crossings->Capacity = Crossings->Capacity ? 2 * Crossings->Capacity : 1024;
+        Crossings->Points = realloc(Crossings->Points, sizeof(struct vec) * Crossings->Capacity);
+    }
+    Crossings->Points[Crossings->Count++] = Point;
+}
+
+// Crossings of one cable's horizontal runs with the other's vertical runs.
+// Sweeping left to right, each vertical run only visits the horizontal runs
+// it actually crosses.
+void FindCrossings(int HorizontalCount, struct segment Horizontal[], int VerticalCount, struct segment Vertical[], struct crossings* Crossings)
+{
+    if(HorizontalCount == 0 || VerticalCount == 0)
+    {
+        return;
+    }
+
+    qsort(Horizontal, HorizontalCount, sizeof(struct segment), CompareRows);
+
+    int EventCount = 0;
+    struct event* Events = malloc(sizeof(struct event) * (2 * HorizontalCount + VerticalCount));
+    for(int i = 0; i < HorizontalCount; ++i)
+    {
+        if(Horizontal[i].Low == Horizontal[i].High)
+        {
+            continue; // Nothing is strictly inside, and it would end before it starts
+        }
+        Events[EventCount++] = (struct event){ Horizontal[i].Low, EVENT_START, i };
+        Events[EventCount++] = (struct event){ Horizontal[i].High, EVENT_END, i };
+    }
+    for(int i = 0; i < VerticalCount; ++i)
+    {
+        Events[EventCount++] = (struct event){ Vertical[i].Fixed, EVENT_CROSS, i };
+    }
+    qsort(Events, EventCount, sizeof(struct event), CompareEvents);
+
+    struct active_set Set = { .Size = 1 };
+    while(Set.Size < HorizontalCount)
+    {
+        Set.Size *= 2;
+    }
+    Set.Counts = calloc(2 * Set.Size, sizeof(int));
+
+    for(int i = 0; i < EventCount; ++i)
+    {
+        struct event* Event = &Events[i];
+        if(Event->Kind == EVENT_START)
+        {
+            Toggle(&Set, Event->Index, 1);
+        }
+        else if(Event->Kind == EVENT_END)
+        {
+            Toggle(&Set, Event->Index, -1);
+        }
+        else
+        {
+            struct segment* Run = &Vertical[Event->Index];
+
+            // First row above the bottom of the run
+            int Low = 0;
+            int High = HorizontalCount;
+            while(Low < High)
+            {
+                int Middle = Low + (High - Low) / 2;
+                if(Horizontal[Middle].Fixed <= Run->Low)
+                {
+                    Low = Middle + 1;
+                }
+                else
+                {
+                    High = Middle;
+                }
+            }
+
+            for(int Slot = NextActive(&Set, Low);
+                Slot != -1 && Horizontal[Slot].Fixed < Run->High;
+                Slot = NextActive(&Set, Slot + 1))
+            {
+                AddCrossing(Crossings, (struct vec){ Run->Fixed, Horizontal[Slot].Fixed });
+            }
+        }
+    }
+
+    free(Set.Counts);
+    free(Events);
+}
+
+// A crossing in a list sorted by row (Across is Y, Along is X) or by
+// column (the other way around)
+struct marker
+{
+    int Across, Along;
+    int Point;
+};
+
+int CompareMarkers(const void* A, const void* B)
+{
+    const struct marker* MarkerA = A;
+    const struct marker* MarkerB = B;
+    if(MarkerA->Across != MarkerB->Across)
+    {
+        return (MarkerA->Across > MarkerB->Across) - (MarkerA->Across < MarkerB->Across);
+    }
+    return (MarkerA->Along > MarkerB->Along) - (MarkerA->Along < MarkerB->Along);
+}
+
+// Next[i] leads past markers that already have their steps
+static inline
+int NextUnvisited(int Next[], int i)
+{
+    while(Next[i] != i)
+    {
+        Next[i] = Next[Next[i]];
+        i = Next[i];
+    }
+    return i;
+}
+
+// Hands out steps to the markers on one run that don't have them yet. The
+// run starts at Start along its line, Steps into the cable.
+void VisitRun(int MarkerCount, struct marker Markers[], int Next[], int Across, int Low, int High, int Start, long long Steps, long long PointSteps[])
+{
+    int First = 0;
+    int Last = MarkerCount;
+    while(First < Last)
+    {
+        int Middle = First + (Last - First) / 2;
+        if(Markers[Middle].Across < Across || (Markers[Middle].Across == Across && Markers[Middle].Along < Low))
+        {
+            First = Middle + 1;
+        }
+        else
+        {
+            Last = Middle;
+        }
+    }
+
+    for(int i = NextUnvisited(Next, First);
+        i < MarkerCount && Markers[i].Across == Across && Markers[i].Along <= High;
+        i = NextUnvisited(Next, i + 1))
+    {
+        long long Visit = Steps + abs(Markers[i].Along - Start);
+        if(Visit == 0)
+        {
+            continue; // Leaving the central port isn't getting there
+        }
+        long long* Point = &PointSteps[Markers[i].Point];
+        if(*Point < 0)
+        {
+            *Point = Visit;
+        }
+        Next[i] = i + 1;
+    }
+}
+
+// Steps the cable takes to first get to each point, -1 if it never does. A
+// cable can cross the other somewhere it has been before, so the steps on
+// the runs that cross aren't enough. Walking the runs in order, each marker
+// is handed its steps the first time and skipped after that.
+void FirstVisits(int Count, struct vec Cable[], int PointCount, struct vec Points[], long long PointSteps[])
+{
+    struct marker* ByRow = malloc(sizeof(struct marker) * PointCount);
+    struct marker* ByColumn = malloc(sizeof(struct marker) * PointCount);
+    int* NextByRow = malloc(sizeof(int) * (PointCount + 1));
+    int* NextByColumn = malloc(sizeof(int) * (PointCount + 1));
+    for(int i = 0; i < PointCount; ++i)
+    {
+        ByRow[i] = (struct marker){ Points[i].Y, Points[i].X, i };
+        ByColumn[i] = (struct marker){ Points[i].X, Points[i].Y, i };
+        PointSteps[i] = -1;
+    }
+    for(int i = 0; i <= PointCount; ++i)
+    {
+        NextByRow[i] = i;
+        NextByColumn[i] = i;
+    }
+    qsort(ByRow, PointCount, sizeof(struct marker), CompareMarkers);
+    qsort(ByColumn, PointCount, sizeof(struct marker), CompareMarkers);
+
+    struct vec Head = CentralPort;
+    long long Steps = 0;
+    for(int i = 0; i < Count; ++i)
+    {
+        struct vec Move = Cable[i];
+        if(Move.Y == 0)
+        {
+            int End = Head.X + Move.X;
+            VisitRun(PointCount, ByRow, NextByRow, Head.Y, Head.X < End ? Head.X : End, Head.X < End ? End : Head.X, Head.X, Steps, PointSteps);
+        }
+        else
+        {
+            int End = Head.Y + Move.Y;
+            VisitRun(PointCount, ByColumn, NextByColumn, Head.X, Head.Y < End ? Head.Y : End, Head.Y < End ? End : Head.Y, Head.Y, Steps, PointSteps);
+        }
+        Head.X += Move.X;
+        Head.Y += Move.Y;
+        Steps += abs(Move.X) + abs(Move.Y);
+    }
+
+    free(NextByColumn);
+    free(NextByRow);
+    free(ByColumn);
+    free(ByRow);
+}
+
 int main(void)
 {
     struct timespec Start, End;
@@ -156,13 +507,43 @@ int main(void)
 
     FILE* Input = fopen("day3_input.txt", "r");
 
-    struct vec Cable1[1024];
-    struct vec Cable2[1024];
+    struct vec* Cable1;
+    struct vec* Cable2;
+
+    int Count1 = LoadCable(Input, &Cable1);
+    int Count2 = LoadCable(Input, &Cable2);
+    fclose(Input);
+
+#if SWEEP
+    struct segment* Horizontal1 = malloc(sizeof(struct segment) * Count1);
+    struct segment* Vertical1 = malloc(sizeof(struct segment) * Count1);
+    struct segment* Horizontal2 = malloc(sizeof(struct segment) * Count2);
+    struct segment* Vertical2 = malloc(sizeof(struct segment) * Count2);
+    int HorizontalCount1 = 0, VerticalCount1 = 0;
+    int HorizontalCount2 = 0, VerticalCount2 = 0;
+    SplitCable(Count1, Cable1, Horizontal1, &HorizontalCount1, Vertical1, &VerticalCount1);
+    SplitCable(Count2, Cable2, Horizontal2, &HorizontalCount2, Vertical2, &VerticalCount2);
+
+    struct crossings Crossings = {0};
+    FindCrossings(HorizontalCount1, Horizontal1, VerticalCount2, Vertical2, &Crossings);
+    FindCrossings(HorizontalCount2, Horizontal2, VerticalCount1, Vertical1, &Crossings);
 
-    int Count1 = LoadCable(Input, Cable1);
-    int Count2 = LoadCable(Input, Cable2);
+    long long* Steps1 = malloc(sizeof(long long) * Crossings.Count);
+    long long* Steps2 = malloc(sizeof(long long) * Crossings.Count);
+    FirstVisits(Count1, Cable1, Crossings.Count, Crossings.Points, Steps1);
+    FirstVisits(Count2, Cable2, Crossings.Count, Crossings.Points, Steps2);
 
-    int ShortestPath = INT_MAX;
+    long long ShortestPath = LLONG_MAX;
+    for(int i = 0; i < Crossings.Count; ++i)
+    {
+        long long Path = Steps1[i] + Steps2[i];
+        if(ShortestPath > Path)
+        {
+            ShortestPath = Path;
+        }
+    }
+#else
+    long long ShortestPath = LLONG_MAX;
 
     struct vec Head1 = CentralPort;
     for(int i = 0; i < Count1; ++i)
@@ -186,8 +567,9 @@ int main(void)
         Head1.X += Cable1[i].X;
         Head1.Y += Cable1[i].Y;
     }
+#endif
 
-    printf("Result: %d\n", ShortestPath);
+    printf("Result: %lld\n", ShortestPath);
 
     clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &End);
     printf("Took: %lds %ldns\n", End.tv_sec - Start.tv_sec, End.tv_nsec - Start.tv_nsec);